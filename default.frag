@@ -1,8 +0,0 @@
-#version 450
-
-layout(location = 0) out vec4 final_color;
-
-void main()
-{
-    final_color = vec4(1.0, 1.0, 1.0, 1.0);
-}
\ No newline at end of file
@@ -1,2 +0,0 @@
-C:\VulkanSDK\1.4.304.1\Bin\glslc.exe default.vert -o vert.spv
-C:\VulkanSDK\1.4.304.1\Bin\glslc.exe default.frag -o frag.spv
\ No newline at end of file
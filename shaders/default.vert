@@ -0,0 +1,41 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Per object data lives in a device local buffer indexed by gl_InstanceIndex (the draw's firstInstance, see
+// src/vk_gpu_scene.h), per frame data is written into the uniform ring. The push constants carry both addresses.
+struct object_data
+{
+    vec4 color;
+    vec4 transform;     // xy offset, z scale, w depth
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer object_buffer
+{
+    object_data objects[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer frame_data
+{
+    mat4 view_projection;
+};
+
+layout(push_constant) uniform constants
+{
+    object_buffer objects;
+    frame_data frame;
+};
+
+layout(location = 0) in vec2 position;
+
+layout(location = 0) out vec4 frag_color;
+
+// The depth prepass runs this shader in a separate pipeline, the color pass depth tests for equality against it
+invariant gl_Position;
+
+void main()
+{
+    object_data object = objects.objects[gl_InstanceIndex];
+    vec2 world = position * object.transform.z + object.transform.xy;
+    gl_Position = frame.view_projection * vec4(world, object.transform.w, 1.0);
+    frag_color = object.color;
+}
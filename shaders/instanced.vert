@@ -0,0 +1,32 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+// Instanced meshes, the per instance stream (binding 1) is filled from the uniform ring every frame (see src/vk_instancing.h)
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer frame_data
+{
+    mat4 view_projection;
+};
+
+layout(push_constant) uniform constants
+{
+    frame_data frame;
+};
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec4 instance_transform;    // xy offset, z scale, w rotation
+layout(location = 2) in vec4 instance_color;
+
+layout(location = 0) out vec4 frag_color;
+
+// The depth prepass runs this shader in a separate pipeline, the color pass depth tests for equality against it
+invariant gl_Position;
+
+void main()
+{
+    float s = sin(instance_transform.w);
+    float c = cos(instance_transform.w);
+    vec2 rotated = vec2(position.x * c - position.y * s, position.x * s + position.y * c);
+    vec2 world = rotated * instance_transform.z + instance_transform.xy;
+    gl_Position = frame.view_projection * vec4(world, 0.0, 1.0);
+    frag_color = instance_color;
+}
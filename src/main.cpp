@@ -2,37 +2,332 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <cmath>
+#include <vector>
 #include "vklib.h"
+#include "vk_jobs.h"
+#include "vk_recorder.h"
+#include "vk_queue.h"
+#include "vk_frame.h"
+#include "vk_pipeline_registry.h"
+#include "vk_uniform_ring.h"
+#include "vk_gpu_scene.h"
+#include "vk_instancing.h"
+#include "vk_render_queue.h"
+#include "vk_cull.h"
+#include "vk_render_graph.h"
+#include "vk_gpu_profiler.h"
+#include "vk_trace.h"
+#include "vk_cpu_profiler.h"
+#include "vk_frame_telemetry.h"
 
 const uint32_t WIN_WIDTH = 1920;
 const uint32_t WIN_HEIGHT = 1080;
 
-const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+// Default for --frames-in-flight, more frames trade latency for throughput
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 8;
 
-std::vector<VkSemaphore> image_available(MAX_FRAMES_IN_FLIGHT);
-std::vector<VkSemaphore> render_finished(MAX_FRAMES_IN_FLIGHT);
-std::vector<VkFence> in_flight(MAX_FRAMES_IN_FLIGHT);
+// Longest the low latency present policy waits for the previous frame to reach the display before giving up on it
+const uint64_t PRESENT_WAIT_TIMEOUT_NS = 100000000;
 
-int main()
+// Default for --telemetry-interval, seconds covered by each frame telemetry report
+const double DEFAULT_TELEMETRY_INTERVAL = 5.0;
+
+// Number of frames rendered when running with --headless and no explicit count
+const uint32_t DEFAULT_HEADLESS_FRAMES = 1000;
+
+const VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+
+// Draws handed to each recording task, small enough to spread a frame's draws over every thread
+const uint32_t DRAWS_PER_RECORD_TASK = 64;
+
+// Per frame / per draw constants for each frame in flight
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 4 * 1024 * 1024;
+
+// The demo scene is a SCENE_GRID_SIZE x SCENE_GRID_SIZE grid of triangles spread over SCENE_EXTENT in each direction,
+// the camera pans across it so a good part of the grid is culled every frame
+const uint32_t SCENE_GRID_SIZE = 320;
+const float SCENE_EXTENT = 2.0f;
+const float SCENE_OBJECT_SCALE = 0.008f;
+
+// Matches object_data in shaders/default.vert (std430)
+struct object_data
+{
+    float color[4];
+    float transform[4];     // xy offset, z scale, w depth (-1 near .. 1 far)
+};
+
+// Matches frame_data in shaders/default.vert (std430)
+struct frame_data
+{
+    float view_projection[16];
+};
+
+// Matches the push constants in shaders/default.vert
+struct scene_constants
+{
+    VkDeviceAddress objects;
+    VkDeviceAddress frame;
+};
+
+// Field of instanced triangles / quads spread over the same area as the grid, culled on the CPU every frame and only
+// the visible ones are instanced
+const uint32_t FIELD_INSTANCE_COUNT = 200000;
+const float FIELD_INSTANCE_SCALE = 0.01f;
+
+// Matches the instance stream in shaders/instanced.vert
+struct instance_data
+{
+    float transform[4];     // xy offset, z scale, w rotation
+    float color[4];
+};
+
+// Render queue passes, the prepass one is only used with --depth-prepass
+const uint8_t PREPASS_QUEUE_PASS = 0;
+const uint8_t COLOR_QUEUE_PASS = 1;
+
+// Set from the GLFW resize callback, some platforms never report VK_ERROR_OUT_OF_DATE_KHR on resize
+bool framebuffer_resized = false;
+
+static void framebuffer_resize_callback(GLFWwindow* window, int width, int height)
+{
+    framebuffer_resized = true;
+}
+
+// Recreates the swapchain, blocking only while the window is minimized
+static int recreate_swapchain(vk_context& context, uint64_t last_submitted_serial)
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    int result;
+    while((result = vk_swapchain_recreate(&context, last_submitted_serial)) == 1)
+    {
+        glfwWaitEvents();
+    }
 
-    GLFWwindow* window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Vulkan Test", NULL, NULL);
+    framebuffer_resized = false;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    // --headless [frames] renders a fixed number of frames into offscreen images with no window or present
+    // --frames-in-flight n sets how many frames the CPU may run ahead of the GPU
+    // --shader-pack path overrides the shaders built into the binary with the ones in a pack (see tools/shader_pack.cpp)
+    // --depth-prepass lays down depth first with depth only pipelines so the color pass only shades visible fragments
+    // --msaa n renders with n samples per pixel into transient attachments resolved into the swapchain / offscreen image
+    // --present throughput|vsync|low-latency picks the swapchain's present policy (see vk_present_policy)
+    // --trace path writes a Chrome trace (chrome://tracing, Perfetto) of CPU zones and GPU passes on exit
+    // --gpu-statistics adds pipeline statistics to the GPU regions where the device supports them
+    // --no-validation runs a build with validation support (REN_DEBUG_LAYERS) without the layers / debug messenger
+    // --swapchain-images n overrides the number of swapchain images the present policy asks for
+    // --telemetry [path] reports frame pacing percentiles (see vk_frame_telemetry.h) to stdout or a JSON lines file
+    // --telemetry-interval s sets how many seconds each telemetry report covers
+    bool headless = false;
+    uint32_t headless_frames = DEFAULT_HEADLESS_FRAMES;
+    uint32_t frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT;
+    const char* shader_pack_path = NULL;
+    bool depth_prepass = false;
+    uint32_t msaa_samples = 1;
+    vk_present_policy present_policy = VK_PRESENT_POLICY_THROUGHPUT;
+    uint32_t swapchain_images = 0;
+    bool validation = true;
+    const char* trace_path = NULL;
+    bool gpu_statistics = false;
+    bool telemetry_enabled = false;
+    const char* telemetry_path = NULL;
+    double telemetry_interval = DEFAULT_TELEMETRY_INTERVAL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--headless") == 0)
+        {
+            headless = true;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                headless_frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+            }
+        }
+        else if(strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            frames_in_flight = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--shader-pack") == 0 && i + 1 < argc)
+        {
+            shader_pack_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "--depth-prepass") == 0)
+        {
+            depth_prepass = true;
+        }
+        else if(strcmp(argv[i], "--msaa") == 0 && i + 1 < argc)
+        {
+            msaa_samples = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--present") == 0 && i + 1 < argc)
+        {
+            const char* policy = argv[++i];
+            if(strcmp(policy, "throughput") == 0) present_policy = VK_PRESENT_POLICY_THROUGHPUT;
+            else if(strcmp(policy, "vsync") == 0) present_policy = VK_PRESENT_POLICY_VSYNC;
+            else if(strcmp(policy, "low-latency") == 0) present_policy = VK_PRESENT_POLICY_LOW_LATENCY;
+            else
+            {
+                std::cerr << "Unknown present policy " << policy << ", expected throughput, vsync or low-latency" << std::endl;
+                return -1;
+            }
+        }
+        else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "--gpu-statistics") == 0)
+        {
+            gpu_statistics = true;
+        }
+        else if(strcmp(argv[i], "--no-validation") == 0)
+        {
+            validation = false;
+        }
+        else if(strcmp(argv[i], "--swapchain-images") == 0 && i + 1 < argc)
+        {
+            swapchain_images = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--telemetry") == 0)
+        {
+            telemetry_enabled = true;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                telemetry_path = argv[++i];
+            }
+        }
+        else if(strcmp(argv[i], "--telemetry-interval") == 0 && i + 1 < argc)
+        {
+            telemetry_interval = strtod(argv[++i], NULL);
+        }
+    }
+
+    if(headless && headless_frames < 1)
+    {
+        std::cerr << "Headless frame count must be at least 1" << std::endl;
+        return -1;
+    }
+
+    if(frames_in_flight < 1 || frames_in_flight > MAX_FRAMES_IN_FLIGHT)
+    {
+        std::cerr << "Frames in flight must be between 1 and " << MAX_FRAMES_IN_FLIGHT << std::endl;
+        return -1;
+    }
 
+    GLFWwindow* window = NULL;
     vk_context context{};
-    vk_init(&context, window);
+    context.debug.validation = validation;
+
+    if(headless)
+    {
+        if(vk_init_headless(&context, WIN_WIDTH, WIN_HEIGHT, frames_in_flight) < 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        glfwInit();
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+        window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Vulkan Test", NULL, NULL);
+        glfwSetFramebufferSizeCallback(window, framebuffer_resize_callback);
+
+        context.present_policy = present_policy;
+        context.swapchain_image_count = swapchain_images;
+        if(vk_init(&context, window) < 0)
+        {
+            return -1;
+        }
+    }
+
+    vk_job_system jobs{};
+    if(vk_job_system_create(&jobs, 0) < 0)
+    {
+        return -1;
+    }
+
+    vk_pipeline_registry pipeline_registry{};
+    if(vk_pipeline_registry_create(context, &pipeline_registry) < 0)
+    {
+        return -1;
+    }
+
+    if(shader_pack_path != NULL && vk_shader_pack_open(shader_pack_path, &context.shader_pack) < 0)
+    {
+        return -1;
+    }
 
     vk_shader shader{};
-    vk_shader_create("../vert.spv", "../frag.spv", context, &shader);
+    vk_shader instanced_shader{};
+    if(vk_shader_create("default.vert", "default.frag", context, &shader) < 0 ||
+       vk_shader_create("instanced.vert", "default.frag", context, &instanced_shader) < 0)
+    {
+        return -1;
+    }
 
-    vk_pipeline_config pipeline_config{};
-    pipeline_config.shader = shader;
+    // Meshes are plain 2D positions
+    vk_vertex_layout vertex_layout{};
+    vertex_layout.bindings.push_back(VkVertexInputBindingDescription{ 0, sizeof(float) * 2, VK_VERTEX_INPUT_RATE_VERTEX });
+    vertex_layout.attributes.push_back(VkVertexInputAttributeDescription{ 0, 0, VK_FORMAT_R32G32_SFLOAT, 0 });
 
-    vk_dynamic_pipeline pipeline{};
-    vk_dynamic_pipeline_create(context, pipeline_config, &pipeline);
+    vk_vertex_layout instanced_layout = vertex_layout;
+    vk_vertex_layout_add_instance_stream(instanced_layout, sizeof(instance_data), {
+        VkVertexInputAttributeDescription{ 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(instance_data, transform) },
+        VkVertexInputAttributeDescription{ 2, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(instance_data, color) } });
 
-    vk_shader_destroy(context, shader);
+    VkFormat depth_format = vk_find_depth_format(context, 0);
+    if(depth_format == VK_FORMAT_UNDEFINED)
+    {
+        std::cerr << "Failed to find a depth format" << std::endl;
+        return -1;
+    }
+
+    // Rounded down to what the device supports (and a power of two)
+    uint32_t sample_bits = 1;
+    while(sample_bits * 2 <= msaa_samples && sample_bits < VK_SAMPLE_COUNT_64_BIT) sample_bits *= 2;
+    VkSampleCountFlagBits samples = vk_max_sample_count(context, (VkSampleCountFlagBits)sample_bits);
+
+    // With a prepass the color pipelines only shade fragments whose depth equals what the prepass left, so each pixel
+    // runs the fragment shader once however much overdraw the scene has
+    vk_pipeline_config pipeline_configs[4];
+    pipeline_configs[0].shader = shader;
+    pipeline_configs[0].vertex_layout = vertex_layout;
+    pipeline_configs[1].shader = instanced_shader;
+    pipeline_configs[1].vertex_layout = instanced_layout;
+    pipeline_configs[1].cull_mode = VK_CULL_MODE_NONE;
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        pipeline_configs[i].depth_format = depth_format;
+        pipeline_configs[i].samples = samples;
+        pipeline_configs[i].depth_test = VK_TRUE;
+        pipeline_configs[i].depth_write = depth_prepass ? VK_FALSE : VK_TRUE;
+        pipeline_configs[i].depth_compare = depth_prepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
+
+        // Depth only versions of both for the prepass, no fragment shader at all
+        pipeline_configs[i + 2] = pipeline_configs[i];
+        pipeline_configs[i + 2].shader.fragment = VK_NULL_HANDLE;
+        pipeline_configs[i + 2].depth_only = 1;
+        pipeline_configs[i + 2].depth_write = VK_TRUE;
+        pipeline_configs[i + 2].depth_compare = VK_COMPARE_OP_LESS_OR_EQUAL;
+    }
+
+    vk_dynamic_pipeline pipelines[4]{};
+    if(vk_pipeline_registry_get(context, pipeline_registry, &jobs, pipeline_configs, depth_prepass ? 4 : 2, pipelines) < 0)
+    {
+        return -1;
+    }
+    vk_dynamic_pipeline& pipeline = pipelines[0];
+    vk_dynamic_pipeline& instanced_pipeline = pipelines[1];
+    vk_dynamic_pipeline& depth_pipeline = pipelines[2];
+    vk_dynamic_pipeline& instanced_depth_pipeline = pipelines[3];
 
 
     // Don't really need these rn because we are rendering directly to the swapchain images...
@@ -47,165 +342,591 @@ int main()
 
     queue_families queues = vk_get_device_queues(context.physical_device, context);
 
-    vk_command_pool command_pool{};
-    vk_command_pool_create(context, &command_pool, queues.graphics);
+    // Command pools per frame in flight and per recording thread, reset wholesale each frame
+    vk_parallel_recorder recorder{};
+    if(vk_parallel_recorder_create(context, queues.graphics, vk_job_thread_count(jobs), frames_in_flight, &recorder) < 0)
+    {
+        return -1;
+    }
+
+    vk_rendering_formats rendering_formats{};
+    rendering_formats.color_formats.push_back(vk_get_color_format(context));
+    rendering_formats.depth_format = depth_format;
+    rendering_formats.stencil_format = VK_FORMAT_UNDEFINED;
+    rendering_formats.samples = samples;
+
+    vk_rendering_formats prepass_formats = rendering_formats;
+    prepass_formats.color_formats.clear();
+
+    vk_staging_ring staging_ring{};
+    if(vk_staging_ring_create(context.allocator, STAGING_RING_SIZE, &staging_ring) < 0)
+    {
+        return -1;
+    }
+
+    vk_uniform_ring uniform_ring{};
+    if(vk_uniform_ring_create(context, UNIFORM_RING_FRAME_SIZE, frames_in_flight, &uniform_ring) < 0)
+    {
+        return -1;
+    }
+
+    // Every object of the scene shares one triangle, drawn GPU driven (see vk_gpu_scene.h)
+    vk_mesh_pool mesh_pool{};
+    if(vk_mesh_pool_create(context.allocator, vertex_layout, 7, 9, &mesh_pool) < 0)
+    {
+        return -1;
+    }
+
+    const float triangle_vertices[] = { 0.0f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f };
+    const uint32_t triangle_indices[] = { 0, 1, 2 };
+    vk_mesh triangle{};
+    if(vk_mesh_create(mesh_pool, staging_ring, triangle_vertices, 3, triangle_indices, 3, &triangle) < 0)
+    {
+        return -1;
+    }
+
+    const float quad_vertices[] = { -0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f };
+    const uint32_t quad_indices[] = { 0, 1, 2, 2, 3, 0 };
+    vk_mesh quad{};
+    if(vk_mesh_create(mesh_pool, staging_ring, quad_vertices, 4, quad_indices, 6, &quad) < 0)
+    {
+        return -1;
+    }
+
+    vk_instance_queue instance_queue{};
+    if(vk_instance_queue_create(sizeof(instance_data), &instance_queue) < 0)
+    {
+        return -1;
+    }
+
+    std::vector<instance_data> field(FIELD_INSTANCE_COUNT);
+    vk_cull_set field_cull;
+    srand(1);
+    for(uint32_t i = 0; i < FIELD_INSTANCE_COUNT; i++)
+    {
+        instance_data& instance = field[i];
+        instance.transform[0] = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * SCENE_EXTENT;
+        instance.transform[1] = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * SCENE_EXTENT;
+        instance.transform[2] = FIELD_INSTANCE_SCALE;
+        instance.transform[3] = (float)rand() / RAND_MAX * 6.2832f;
+        instance.color[0] = 0.2f;
+        instance.color[1] = 0.5f + (float)rand() / RAND_MAX * 0.5f;
+        instance.color[2] = 0.2f;
+        instance.color[3] = 1.0f;
+
+        // Both meshes fit in a circle of radius ~0.71 whatever the rotation
+        float center[3] = { instance.transform[0], instance.transform[1], 0.0f };
+        vk_cull_set_add_sphere(field_cull, center, 0.71f * FIELD_INSTANCE_SCALE, i);
+    }
+
+    // Everything drawn on the CPU side goes through the sorted render queue, the GPU driven scene is recorded on its own
+    vk_render_queue render_queue{};
+
+    const uint32_t object_count = SCENE_GRID_SIZE * SCENE_GRID_SIZE;
+    vk_gpu_scene scene{};
+    if(vk_gpu_scene_create(context, object_count, frames_in_flight, &scene) < 0)
+    {
+        return -1;
+    }
 
-    vk_command_pool_add_buffers(context, command_pool, MAX_FRAMES_IN_FLIGHT);
+    vk_buffer object_buffer{};
+    if(vk_buffer_create(context.allocator, object_count * sizeof(object_data), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &object_buffer) < 0)
+    {
+        std::cerr << "Failed to create object buffer" << std::endl;
+        return -1;
+    }
 
-    VkSemaphoreCreateInfo semaphore_info{};
-    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    
-    VkFenceCreateInfo fence_info{};
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VkBufferDeviceAddressInfo object_address_info{};
+    object_address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    object_address_info.buffer = object_buffer.buffer;
+    VkDeviceAddress object_address = vkGetBufferDeviceAddress(context.logical_device, &object_address_info);
 
-    for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    std::vector<object_data> objects(object_count);
+    for(uint32_t i = 0; i < object_count; i++)
     {
-        if(vkCreateSemaphore(context.logical_device, &semaphore_info, NULL, &image_available[i]) != VK_SUCCESS ||
-        vkCreateSemaphore(context.logical_device, &semaphore_info, NULL, &render_finished[i]) != VK_SUCCESS ||
-        vkCreateFence(context.logical_device, &fence_info, NULL, &in_flight[i]) != VK_SUCCESS)
+        float u = (float)(i % SCENE_GRID_SIZE) / (SCENE_GRID_SIZE - 1);
+        float v = (float)(i / SCENE_GRID_SIZE) / (SCENE_GRID_SIZE - 1);
+
+        object_data& object = objects[i];
+        object.color[0] = u;
+        object.color[1] = v;
+        object.color[2] = 1.0f - u;
+        object.color[3] = 1.0f;
+        object.transform[0] = (u * 2.0f - 1.0f) * SCENE_EXTENT;
+        object.transform[1] = (v * 2.0f - 1.0f) * SCENE_EXTENT;
+        object.transform[2] = SCENE_OBJECT_SCALE;
+        object.transform[3] = (float)rand() / RAND_MAX * 1.8f - 0.9f;
+
+        // The triangle's corners are at most ~0.56 from its origin
+        float bounds[4] = { object.transform[0], object.transform[1], object.transform[3], 0.56f * SCENE_OBJECT_SCALE };
+        if(vk_gpu_scene_add(scene, staging_ring, triangle, bounds, i, NULL) < 0)
         {
-            std::cerr << "Failed to create synchronization objects" << std::endl;
             return -1;
         }
     }
 
+    if(vk_staging_ring_upload(staging_ring, object_buffer.buffer, 0, objects.data(), objects.size() * sizeof(object_data)) < 0)
+    {
+        std::cerr << "Failed to upload scene objects" << std::endl;
+        return -1;
+    }
+
+    // Uploads go through the DMA queue when there is one so they overlap rendering instead of running ahead of it
+    vk_async_queue transfer_queue{};
+    if(queues.has_transfer && vk_async_queue_create(context, queues.transfer, &transfer_queue) < 0)
+    {
+        return -1;
+    }
+
+    vk_frame_scheduler scheduler{};
+    if(vk_frame_scheduler_create(context, frames_in_flight, &scheduler) < 0)
+    {
+        return -1;
+    }
+
     VkQueue graphics_queue;
     VkQueue present_queue;
 
     vkGetDeviceQueue(context.logical_device, queues.graphics, 0, &graphics_queue);
-    vkGetDeviceQueue(context.logical_device, queues.present, 0, &present_queue);
-
-    uint32_t current_frame = 0;
+    if(!headless)
+    {
+        vkGetDeviceQueue(context.logical_device, queues.present, 0, &present_queue);
+    }
 
+    uint32_t frames_rendered = 0;
 
-    PFN_vkCmdBeginRenderingKHR vkCmdBeginRenderingKHR_ext = (PFN_vkCmdBeginRenderingKHR)vkGetInstanceProcAddr(context.instance, "vkCmdBeginRenderingKHR");
-    PFN_vkCmdEndRenderingKHR vkCmdEndRenderingKHR_ext = (PFN_vkCmdEndRenderingKHR)vkGetInstanceProcAddr(context.instance, "vkCmdEndRenderingKHR");
+    // GPU time of every render graph pass and the culling dispatch, read back frames_in_flight frames later
+    vk_trace trace;
+    vk_gpu_profiler gpu_profiler{};
+    if(vk_gpu_profiler_create(context, frames_in_flight, gpu_statistics, &gpu_profiler) < 0)
+    {
+        return -1;
+    }
+    gpu_profiler.trace = trace_path != NULL ? &trace : NULL;
+    if(trace_path != NULL)
+    {
+        vk_cpu_profiler_start();
+    }
 
-    if(!vkCmdBeginRenderingKHR_ext || !vkCmdEndRenderingKHR_ext)
+    // Acquire / frame wait / record / present timing of every frame
+    vk_frame_telemetry telemetry{};
+    if(telemetry_enabled && vk_frame_telemetry_create(telemetry_path, telemetry_interval, &telemetry) < 0)
     {
-        std::cerr << "Failed to load rendering procs" << std::endl;
         return -1;
     }
 
-    while(!glfwWindowShouldClose(window))
+    // Rebuilt every frame, works out the layout transitions / barriers between passes (see vk_render_graph.h)
+    vk_render_graph graph{};
+    graph.profiler = &gpu_profiler;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    while(headless ? frames_rendered < headless_frames : !glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
+        VK_CPU_ZONE("frame");
 
-        vkWaitForFences(context.logical_device, 1, &in_flight[current_frame], VK_TRUE, UINT64_MAX);
+        if(!headless)
+        {
+            // Low latency starts a frame only once the previous one is on screen, input is sampled right before it's needed
+            if(context.present_policy == VK_PRESENT_POLICY_LOW_LATENCY)
+            {
+                vk_swapchain_wait_present(&context, PRESENT_WAIT_TIMEOUT_NS);
+            }
+            if(telemetry_enabled)
+            {
+                vk_frame_telemetry_poll(context, telemetry);
+            }
+            VK_CPU_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
 
-        uint32_t image_index;
-        VkResult acquire_result = vkAcquireNextImageKHR(context.logical_device, context.swapchain.swapchain, UINT64_MAX, image_available[current_frame], VK_NULL_HANDLE, &image_index);
-        vkResetFences(context.logical_device, 1, &in_flight[current_frame]);
+        uint32_t current_frame = vk_frame_begin(context, scheduler);
+        if(telemetry_enabled)
+        {
+            vk_frame_telemetry_record(telemetry, VK_FRAME_METRIC_FRAME_WAIT, std::chrono::nanoseconds(scheduler.wait_ns));
+        }
+        vk_debug_log_flush(context.debug_log);
+        vk_staging_ring_retire(staging_ring, queues.has_transfer ? vk_async_queue_completed(context, transfer_queue) : scheduler.completed);
+        vk_bindless_collect(context.bindless, scheduler.completed);
+        if(!headless)
+        {
+            vk_swapchain_collect(&context, scheduler.completed);
+        }
+        vk_render_graph_collect(context, graph, scheduler.completed);
+
+        // Offscreen images are owned per frame slot so there is nothing to acquire
+        uint32_t image_index = current_frame;
+        if(!headless)
+        {
+            VkResult acquire_result;
+            auto acquire_start = std::chrono::steady_clock::now();
+            {
+                VK_CPU_ZONE("vkAcquireNextImageKHR");
+                acquire_result = vkAcquireNextImageKHR(context.logical_device, context.swapchain.swapchain, UINT64_MAX, scheduler.image_available[current_frame], VK_NULL_HANDLE, &image_index);
+            }
+            if(telemetry_enabled)
+            {
+                vk_frame_telemetry_record(telemetry, VK_FRAME_METRIC_ACQUIRE_WAIT, std::chrono::steady_clock::now() - acquire_start);
+            }
+            if(acquire_result == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                // Nothing was acquired or submitted so the next vk_frame_begin hands out the same slot again
+                if(recreate_swapchain(context, scheduler.submitted) < 0)
+                {
+                    return -1;
+                }
+                continue;
+            }
+            else if(acquire_result != VK_SUCCESS && acquire_result != VK_SUBOPTIMAL_KHR)
+            {
+                std::cerr << "Failed to acquire swapchain image" << std::endl;
+                return -1;
+            }
+        }
 
-        vkResetCommandBuffer(command_pool.buffers[current_frame], 0);
+        VkExtent2D extent = vk_get_render_extent(context);
+
+        auto record_start = std::chrono::steady_clock::now();
+        VkCommandBuffer cmd = vk_parallel_recorder_begin_frame(context, recorder, current_frame);
+        vk_uniform_ring_begin_frame(uniform_ring, current_frame);
 
         VkCommandBufferBeginInfo begin_info{};
         begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        if(vkBeginCommandBuffer(command_pool.buffers[current_frame], &begin_info) != VK_SUCCESS)
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if(vkBeginCommandBuffer(cmd, &begin_info) != VK_SUCCESS)
         {
             std::cerr << "Failed to start command buffer" << std::endl;
             return -1;
         }
+        vk_gpu_profiler_begin_frame(context, gpu_profiler, cmd, current_frame);
 
-        VkRenderingAttachmentInfoKHR color_attachment{};
-        color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
-        color_attachment.imageView = context.swapchain.image_views[image_index];
-        color_attachment.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL_KHR;
-        color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-        color_attachment.clearValue = {{{0.3f, 0.3f, 0.3f, 1.0f}}};
+        // Every upload queued since last frame goes out ahead of this frame's rendering
+        std::vector<VkSemaphoreSubmitInfo> wait_infos;
+        if(queues.has_transfer)
+        {
+            if(!staging_ring.pending.empty())
+            {
+                VkCommandBuffer transfer_cmd = vk_async_queue_begin(context, transfer_queue);
+                if(transfer_cmd == VK_NULL_HANDLE)
+                {
+                    return -1;
+                }
+
+                vk_staging_ring_record_transfer(staging_ring, transfer_cmd, transfer_queue.submitted + 1);
+                uint64_t upload_value = vk_async_queue_submit(context, transfer_queue, transfer_cmd, NULL, 0);
+                if(upload_value == 0)
+                {
+                    return -1;
+                }
+
+                // Only the stages reading the uploaded data wait, everything before them overlaps the copies
+                wait_infos.push_back(vk_async_queue_wait_info(transfer_queue, upload_value, VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                                              VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT));
+            }
+        }
+        else
+        {
+            vk_staging_ring_record(staging_ring, cmd, vk_frame_value(scheduler));
+        }
 
+        // Camera pans back and forth across the grid
+        float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time).count();
+        float camera_x = sinf(time * 0.5f) * SCENE_EXTENT;
+        float camera_y = cosf(time * 0.3f) * SCENE_EXTENT * 0.5f;
 
-        VkRenderingInfoKHR rendering_info{};
-        rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
-        rendering_info.renderArea = VkRect2D{VkOffset2D{}, context.swapchain.extent};
-        rendering_info.layerCount = 1;
-        rendering_info.colorAttachmentCount = 1;
-        rendering_info.pColorAttachments = &color_attachment;
+        vk_uniform_allocation frame_constants;
+        if(vk_uniform_ring_alloc(uniform_ring, sizeof(frame_data), &frame_constants) < 0)
+        {
+            return -1;
+        }
 
-        vkCmdBeginRenderingKHR_ext(command_pool.buffers[current_frame], &rendering_info);
+        // Column major, orthographic with world z -1..1 mapped to depth 0..1
+        frame_data* frame = (frame_data*)frame_constants.data;
+        memset(frame->view_projection, 0, sizeof(frame->view_projection));
+        frame->view_projection[0] = 1.0f;
+        frame->view_projection[5] = 1.0f;
+        frame->view_projection[10] = 0.5f;
+        frame->view_projection[12] = -camera_x;
+        frame->view_projection[13] = -camera_y;
+        frame->view_projection[14] = 0.5f;
+        frame->view_projection[15] = 1.0f;
+
+        float frustum[6][4];
+        vk_frustum_planes(frame->view_projection, frustum);
+        uint32_t cull_region = vk_gpu_profiler_begin(gpu_profiler, cmd, "gpu_cull");
+        vk_gpu_scene_cull(cmd, scene, current_frame, frustum);
+        vk_gpu_profiler_end(gpu_profiler, cmd, cull_region);
+
+        scene_constants constants{};
+        constants.objects = object_address;
+        constants.frame = frame_constants.address;
+
+        uint32_t visible_count = vk_cull_frustum(field_cull, &jobs, frustum);
+
+        // Visible instances are added one at a time like independent objects would be, the queue folds them into one draw per mesh
+        vk_instance_queue_begin(instance_queue);
+        for(uint32_t i = 0; i < visible_count; i++)
+        {
+            uint32_t index = field_cull.visible[i];
+            vk_instance_queue_add(instance_queue, instanced_pipeline.pipeline, mesh_pool, index % 2 ? quad : triangle, &field[index], 1);
+        }
 
-        // Rendering commands here
-        vkCmdBindPipeline(command_pool.buffers[current_frame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+        if(vk_instance_queue_build(instance_queue, uniform_ring) < 0)
+        {
+            return -1;
+        }
 
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float>(context.swapchain.extent.width);
-        viewport.height = static_cast<float>(context.swapchain.extent.height);
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(command_pool.buffers[current_frame], 0, 1, &viewport);
 
         VkRect2D scissor{};
         scissor.offset = {0, 0};
-        scissor.extent = context.swapchain.extent;
-        vkCmdSetScissor(command_pool.buffers[current_frame], 0, 1, &scissor);
+        scissor.extent = extent;
 
-        vkCmdDraw(command_pool.buffers[current_frame], 3, 1, 0, 0);
+        // The prepass draws the same instances again with the depth only pipeline
+        vk_render_queue_begin(render_queue);
+        vk_render_queue_set_pass(render_queue, PREPASS_QUEUE_PASS, viewport, scissor);
+        vk_render_queue_set_pass(render_queue, COLOR_QUEUE_PASS, viewport, scissor);
+        if(depth_prepass)
+        {
+            vk_instance_queue_submit(instance_queue, render_queue, PREPASS_QUEUE_PASS, instanced_depth_pipeline.pipeline, &frame_constants.address, sizeof(frame_constants.address));
+        }
+        vk_instance_queue_submit(instance_queue, render_queue, COLOR_QUEUE_PASS, VK_NULL_HANDLE, &frame_constants.address, sizeof(frame_constants.address));
+        vk_render_queue_sort(render_queue, &jobs);
+
+        // Swapchain images come out of acquire in an undefined layout once the semaphore wait (color output) is done,
+        // offscreen images are simply overwritten every frame
+        vk_render_graph_begin(graph);
+        uint32_t backbuffer = vk_render_graph_import_image(graph, headless ? context.offscreen.images[image_index].image : context.swapchain.images[image_index],
+                                                           headless ? context.offscreen.image_views[image_index] : context.swapchain.image_views[image_index],
+                                                           vk_get_color_format(context), extent, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                                           headless ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+        // Depth and multisampled color never outlive the frame, the graph gives them transient images. Without a prepass
+        // neither leaves the scene pass so they end up as lazily allocated transient attachments where the device has them
+        uint32_t depth = vk_render_graph_create_image(graph, depth_format, extent, samples);
+        uint32_t color = samples > VK_SAMPLE_COUNT_1_BIT ? vk_render_graph_create_image(graph, vk_get_color_format(context), extent, samples) : backbuffer;
+
+        // Rendering commands here, recorded into secondaries across the job system
+        // Secondaries don't inherit bound state so every task binds the pipeline and the bindless heap and sets the dynamic state itself
+        int record_result = 0;
+        auto record_scene = [&](VkCommandBuffer pass_cmd, const vk_rendering_formats& formats, VkPipeline scene_pipeline, uint8_t queue_pass)
+        {
+            if(record_result < 0) return;
+
+            // The whole scene is a single indirect draw
+            uint32_t draw_count = 1;
+            record_result = vk_parallel_record(context, recorder, jobs, current_frame, pass_cmd, formats, draw_count, DRAWS_PER_RECORD_TASK,
+                [&](VkCommandBuffer secondary, uint32_t begin, uint32_t end)
+                {
+                    vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, scene_pipeline);
+                    vk_bindless_bind(secondary, context.bindless, VK_PIPELINE_BIND_POINT_GRAPHICS);
+                    vkCmdSetViewport(secondary, 0, 1, &viewport);
+                    vkCmdSetScissor(secondary, 0, 1, &scissor);
+                    vk_mesh_pool_bind(secondary, mesh_pool);
+                    vk_bindless_push(secondary, context.bindless, &constants, sizeof(constants));
+                    vk_gpu_scene_draw(secondary, scene, current_frame);
+                });
+
+            if(record_result < 0) return;
+
+            uint32_t first_packet, end_packet;
+            vk_render_queue_pass_range(render_queue, queue_pass, &first_packet, &end_packet);
+            record_result = vk_parallel_record(context, recorder, jobs, current_frame, pass_cmd, formats, end_packet - first_packet, DRAWS_PER_RECORD_TASK,
+                [&](VkCommandBuffer secondary, uint32_t begin, uint32_t end)
+                {
+                    vk_render_queue_record(secondary, render_queue, context.bindless, first_packet + begin, first_packet + end);
+                });
+        };
+
+        if(depth_prepass)
+        {
+            uint32_t prepass = vk_render_graph_add_pass(graph, "depth_prepass", VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, [&](VkCommandBuffer pass_cmd)
+            {
+                record_scene(pass_cmd, prepass_formats, depth_pipeline.pipeline, PREPASS_QUEUE_PASS);
+            });
+            vk_render_graph_depth_attachment(graph, prepass, depth, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, 1.0f, 1);
+        }
 
-        vkCmdEndRenderingKHR_ext(command_pool.buffers[current_frame]);
+        uint32_t scene_pass = vk_render_graph_add_pass(graph, "scene", VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, [&](VkCommandBuffer pass_cmd)
+        {
+            record_scene(pass_cmd, rendering_formats, pipeline.pipeline, COLOR_QUEUE_PASS);
+        });
+        if(color != backbuffer)
+        {
+            vk_render_graph_color_attachment(graph, scene_pass, color, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE, {{0.3f, 0.3f, 0.3f, 1.0f}});
+            vk_render_graph_resolve_attachment(graph, scene_pass, color, backbuffer);
+        }
+        else
+        {
+            vk_render_graph_color_attachment(graph, scene_pass, backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, {{0.3f, 0.3f, 0.3f, 1.0f}});
+        }
+        if(depth_prepass)
+        {
+            vk_render_graph_depth_attachment(graph, scene_pass, depth, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_DONT_CARE, 1.0f, 0);
+        }
+        else
+        {
+            vk_render_graph_depth_attachment(graph, scene_pass, depth, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE, 1.0f, 1);
+        }
 
-        if(vkEndCommandBuffer(command_pool.buffers[current_frame]) != VK_SUCCESS)
+        if(vk_render_graph_compile(context, graph, vk_frame_value(scheduler)) < 0)
+        {
+            return -1;
+        }
+
+        vk_render_graph_execute(graph, cmd);
+        if(record_result < 0)
         {
-            std::cerr << "Failed to end command buffer" << std::endl;
             return -1;
         }
 
-        VkSubmitInfo submit_info{};
-        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        
-        VkSemaphore wait_semaphores[] = { image_available[current_frame] };
-        VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submit_info.waitSemaphoreCount = 1;
-        submit_info.pWaitSemaphores = wait_semaphores;
-        submit_info.pWaitDstStageMask = wait_stages;
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &command_pool.buffers[current_frame];
+        if(vkEndCommandBuffer(cmd) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to end command buffer" << std::endl;
+            return -1;
+        }
+        if(telemetry_enabled)
+        {
+            vk_frame_telemetry_record(telemetry, VK_FRAME_METRIC_RECORD, std::chrono::steady_clock::now() - record_start);
+        }
 
-        VkSemaphore signal_semaphores[] = { render_finished[current_frame] };
-        submit_info.signalSemaphoreCount = 1;
-        submit_info.pSignalSemaphores = signal_semaphores;
+        if(!headless)
+        {
+            VkSemaphoreSubmitInfo image_wait{};
+            image_wait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            image_wait.semaphore = scheduler.image_available[current_frame];
+            image_wait.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+            wait_infos.push_back(image_wait);
+        }
 
-        if(vkQueueSubmit(graphics_queue, 1, &submit_info, in_flight[current_frame]) != VK_SUCCESS)
+        VkCommandBufferSubmitInfo cmd_info{};
+        cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        cmd_info.commandBuffer = cmd;
+
+        // The frame timeline is signaled once everything is done, the binary semaphore only gates present
+        VkSemaphoreSubmitInfo signal_infos[2];
+        signal_infos[0] = vk_frame_signal_info(scheduler);
+        signal_infos[1] = VkSemaphoreSubmitInfo{};
+        signal_infos[1].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        signal_infos[1].semaphore = headless ? VK_NULL_HANDLE : scheduler.render_finished[current_frame];
+        // All commands so the graph's final transition to PRESENT_SRC_KHR is covered too
+        signal_infos[1].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+        VkSubmitInfo2 submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submit_info.waitSemaphoreInfoCount = wait_infos.size();
+        submit_info.pWaitSemaphoreInfos = wait_infos.data();
+        submit_info.commandBufferInfoCount = 1;
+        submit_info.pCommandBufferInfos = &cmd_info;
+        submit_info.signalSemaphoreInfoCount = headless ? 1 : 2;
+        submit_info.pSignalSemaphoreInfos = signal_infos;
+
+        VkResult submit_result;
+        {
+            VK_CPU_ZONE("vkQueueSubmit2");
+            submit_result = vkQueueSubmit2(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
+        }
+        if(submit_result != VK_SUCCESS)
         {
             std::cerr << "Failed to submit to graphics queue" << std::endl;
             return -1;
         }
+        auto submit_time = std::chrono::steady_clock::now();
+        vk_frame_submitted(scheduler);
 
-        VkPresentInfoKHR present_info{};
-        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-        present_info.waitSemaphoreCount = 1;
-        present_info.pWaitSemaphores = signal_semaphores;
+        frames_rendered++;
 
-        VkSwapchainKHR swapchains[] = { context.swapchain.swapchain };
-        present_info.swapchainCount = 1;
-        present_info.pSwapchains = swapchains;
-        present_info.pImageIndices = &image_index;
-        present_info.pResults = NULL;
+        if(headless)
+        {
+            // Nothing is presented, the submit stands in for it
+            if(telemetry_enabled)
+            {
+                vk_frame_telemetry_presented(telemetry, submit_time);
+                vk_frame_telemetry_end_frame(telemetry);
+            }
+            continue;
+        }
 
-        VkResult present_result = vkQueuePresentKHR(present_queue, &present_info);
+        VkResult present_result = vk_swapchain_present(&context, present_queue, scheduler.render_finished[current_frame], image_index);
+        if(telemetry_enabled)
+        {
+            if(present_result == VK_SUCCESS || present_result == VK_SUBOPTIMAL_KHR)
+            {
+                vk_frame_telemetry_queue_present(context, telemetry, submit_time);
+            }
+            vk_frame_telemetry_end_frame(telemetry);
+        }
+        if(present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR || framebuffer_resized)
+        {
+            if(recreate_swapchain(context, scheduler.submitted) < 0)
+            {
+                return -1;
+            }
+        }
+        else if(present_result != VK_SUCCESS)
+        {
+            std::cerr << "Failed to present swapchain image" << std::endl;
+            return -1;
+        }
+    }
 
-        current_frame = (current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+    vkDeviceWaitIdle(context.logical_device);
+    vk_gpu_profiler_read_pending(context, gpu_profiler);
+    vk_cpu_profiler_stop(trace_path != NULL ? &trace : NULL);
+    if(telemetry_enabled)
+    {
+        vk_frame_telemetry_poll(context, telemetry);
+        vk_frame_telemetry_destroy(telemetry);
+    }
 
+    if(headless)
+    {
+        double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "Rendered " << frames_rendered << " headless frames in " << elapsed_ms << " ms (" << elapsed_ms / frames_rendered << " ms/frame)" << std::endl;
     }
 
-    vkDeviceWaitIdle(context.logical_device);
+    for(const vk_gpu_region_result& result : gpu_profiler.results)
+    {
+        std::cout << "GPU " << result.name << ": " << result.duration_ms << " ms" << std::endl;
+    }
 
-    for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    if(trace_path != NULL && vk_trace_write(trace, trace_path) == 0)
     {
-        vkDestroySemaphore(context.logical_device, image_available[i], NULL);
-        vkDestroySemaphore(context.logical_device, render_finished[i], NULL);
-        vkDestroyFence(context.logical_device, in_flight[i], NULL);
+        std::cout << "Wrote trace to " << trace_path << std::endl;
     }
 
-    vk_command_pool_destroy(context, command_pool);
-    vk_dynamic_pipeline_destroy(context, pipeline);
+    vk_frame_scheduler_destroy(context, scheduler);
+
+    if(queues.has_transfer)
+    {
+        vk_async_queue_destroy(context, transfer_queue);
+    }
+    vk_render_graph_destroy(context, graph);
+    vk_gpu_profiler_destroy(context, gpu_profiler);
+    vk_buffer_destroy(context.allocator, object_buffer);
+    vk_gpu_scene_destroy(context, scene);
+    vk_mesh_pool_destroy(context.allocator, mesh_pool);
+    vk_uniform_ring_destroy(context, uniform_ring);
+    vk_staging_ring_destroy(context.allocator, staging_ring);
+    vk_parallel_recorder_destroy(context, recorder);
+    vk_job_system_destroy(jobs);
+    vk_pipeline_registry_destroy(context, pipeline_registry);
+    vk_shader_destroy(context, instanced_shader);
+    vk_shader_destroy(context, shader);
     vk_terminate(&context);
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if(!headless)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 
     return 0;
 }
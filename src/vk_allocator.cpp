@@ -0,0 +1,581 @@
+#include "vk_allocator.h"
+#include <iostream>
+#include <algorithm>
+
+// Every range is a multiple of this so alignment padding always fits in a free range of its own
+#define ALIGN_LOG2 4
+#define MIN_ALIGNMENT (1ull << ALIGN_LOG2)
+#define FL_INDEX_SHIFT (VK_ALLOCATOR_SL_LOG2 + ALIGN_LOG2)
+#define SMALL_RANGE_SIZE (1ull << FL_INDEX_SHIFT)
+#define INVALID_INDEX UINT32_MAX
+
+static uint32_t find_last_set(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+static uint32_t find_first_set(uint32_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void mapping_insert(VkDeviceSize size, uint32_t* fl, uint32_t* sl)
+{
+    if(size < SMALL_RANGE_SIZE)
+    {
+        *fl = 0;
+        *sl = (uint32_t)(size >> ALIGN_LOG2);
+        return;
+    }
+
+    uint32_t last = find_last_set(size);
+    *sl = (uint32_t)(size >> (last - VK_ALLOCATOR_SL_LOG2)) ^ (1 << VK_ALLOCATOR_SL_LOG2);
+    *fl = last - (FL_INDEX_SHIFT - 1);
+}
+
+// Rounds size up to the next list boundary so any range found in the resulting list is big enough
+static void mapping_search(VkDeviceSize size, uint32_t* fl, uint32_t* sl)
+{
+    if(size >= SMALL_RANGE_SIZE)
+    {
+        size += (1ull << (find_last_set(size) - VK_ALLOCATOR_SL_LOG2)) - 1;
+    }
+    mapping_insert(size, fl, sl);
+}
+
+static uint32_t node_create(vk_memory_pool& pool)
+{
+    if(!pool.unused_nodes.empty())
+    {
+        uint32_t index = pool.unused_nodes.back();
+        pool.unused_nodes.pop_back();
+        return index;
+    }
+
+    pool.nodes.push_back(vk_memory_node{});
+    return pool.nodes.size() - 1;
+}
+
+static void node_release(vk_memory_pool& pool, uint32_t index)
+{
+    pool.nodes[index].block = INVALID_INDEX;
+    pool.unused_nodes.push_back(index);
+}
+
+static void free_list_insert(vk_memory_pool& pool, uint32_t index)
+{
+    vk_memory_node& node = pool.nodes[index];
+    uint32_t fl, sl;
+    mapping_insert(node.size, &fl, &sl);
+
+    uint32_t head = pool.free_heads[fl][sl];
+    node.free = 1;
+    node.prev_free = INVALID_INDEX;
+    node.next_free = head;
+    if(head != INVALID_INDEX)
+    {
+        pool.nodes[head].prev_free = index;
+    }
+
+    pool.free_heads[fl][sl] = index;
+    pool.fl_bitmap |= 1u << fl;
+    pool.sl_bitmap[fl] |= 1u << sl;
+}
+
+static void free_list_remove(vk_memory_pool& pool, uint32_t index)
+{
+    vk_memory_node& node = pool.nodes[index];
+    uint32_t fl, sl;
+    mapping_insert(node.size, &fl, &sl);
+
+    if(node.prev_free != INVALID_INDEX)
+    {
+        pool.nodes[node.prev_free].next_free = node.next_free;
+    }
+    if(node.next_free != INVALID_INDEX)
+    {
+        pool.nodes[node.next_free].prev_free = node.prev_free;
+    }
+
+    if(pool.free_heads[fl][sl] == index)
+    {
+        pool.free_heads[fl][sl] = node.next_free;
+        if(node.next_free == INVALID_INDEX)
+        {
+            pool.sl_bitmap[fl] &= ~(1u << sl);
+            if(pool.sl_bitmap[fl] == 0)
+            {
+                pool.fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+
+    node.free = 0;
+    node.prev_free = INVALID_INDEX;
+    node.next_free = INVALID_INDEX;
+}
+
+static uint32_t find_free_node(vk_memory_pool& pool, VkDeviceSize size)
+{
+    uint32_t fl, sl;
+    mapping_search(size, &fl, &sl);
+    if(fl >= VK_ALLOCATOR_FL_COUNT) return INVALID_INDEX;
+
+    uint32_t sl_map = pool.sl_bitmap[fl] & (~0u << sl);
+    if(sl_map == 0)
+    {
+        // Nothing left in this first level, take the smallest range from a larger one
+        uint32_t fl_map = fl + 1 < 32 ? pool.fl_bitmap & (~0u << (fl + 1)) : 0;
+        if(fl_map == 0) return INVALID_INDEX;
+
+        fl = find_first_set(fl_map);
+        sl_map = pool.sl_bitmap[fl];
+    }
+
+    sl = find_first_set(sl_map);
+    return pool.free_heads[fl][sl];
+}
+
+// Splits the first size bytes off a free node, the remainder is inserted as a new free node right after it
+static void node_split(vk_memory_pool& pool, uint32_t index, VkDeviceSize size)
+{
+    uint32_t remainder_index = node_create(pool);
+    vk_memory_node& node = pool.nodes[index];
+    vk_memory_node& remainder = pool.nodes[remainder_index];
+
+    remainder.offset = node.offset + size;
+    remainder.size = node.size - size;
+    remainder.block = node.block;
+    remainder.prev_physical = index;
+    remainder.next_physical = node.next_physical;
+    if(node.next_physical != INVALID_INDEX)
+    {
+        pool.nodes[node.next_physical].prev_physical = remainder_index;
+    }
+
+    node.size = size;
+    node.next_physical = remainder_index;
+
+    free_list_insert(pool, remainder_index);
+}
+
+// Absorbs next into index, both must already be out of the free lists
+static void node_merge(vk_memory_pool& pool, uint32_t index, uint32_t next)
+{
+    vk_memory_node& node = pool.nodes[index];
+    vk_memory_node& absorbed = pool.nodes[next];
+
+    node.size += absorbed.size;
+    node.next_physical = absorbed.next_physical;
+    if(absorbed.next_physical != INVALID_INDEX)
+    {
+        pool.nodes[absorbed.next_physical].prev_physical = index;
+    }
+
+    node_release(pool, next);
+}
+
+// Returns the free node spanning the new block or INVALID_INDEX
+static uint32_t pool_add_block(vk_allocator& allocator, vk_memory_pool& pool, VkDeviceSize min_size)
+{
+    VkDeviceSize size = std::max(pool.block_size, align_up(min_size, MIN_ALIGNMENT));
+
+    VkMemoryAllocateFlagsInfo flags_info{};
+    flags_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    flags_info.flags = allocator.allocate_flags;
+
+    VkMemoryAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = size;
+    alloc_info.memoryTypeIndex = pool.memory_type;
+    alloc_info.pNext = allocator.allocate_flags ? &flags_info : NULL;
+
+    vk_memory_block block{};
+    block.size = size;
+
+    if(vkAllocateMemory(allocator.device, &alloc_info, NULL, &block.memory) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to allocate device memory block" << std::endl;
+        return INVALID_INDEX;
+    }
+
+    if(allocator.memory_properties.memoryTypes[pool.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        if(vkMapMemory(allocator.device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to map device memory block" << std::endl;
+            vkFreeMemory(allocator.device, block.memory, NULL);
+            return INVALID_INDEX;
+        }
+    }
+
+    // Reuse a slot left behind by vk_allocator_trim so block indices stay stable
+    uint32_t block_index = pool.blocks.size();
+    for(uint32_t i = 0; i < pool.blocks.size(); i++)
+    {
+        if(pool.blocks[i].memory == VK_NULL_HANDLE)
+        {
+            block_index = i;
+            break;
+        }
+    }
+
+    if(block_index == pool.blocks.size())
+    {
+        pool.blocks.push_back(block);
+    }
+    else
+    {
+        pool.blocks[block_index] = block;
+    }
+
+    uint32_t index = node_create(pool);
+    vk_memory_node& node = pool.nodes[index];
+    node.offset = 0;
+    node.size = size;
+    node.block = block_index;
+    node.prev_physical = INVALID_INDEX;
+    node.next_physical = INVALID_INDEX;
+    free_list_insert(pool, index);
+
+    return index;
+}
+
+int vk_allocator_create(VkPhysicalDevice physical_device, VkDevice device, vk_allocator* allocator)
+{
+    if(allocator == NULL) return -1;
+
+    allocator->device = device;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &allocator->memory_properties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    allocator->buffer_image_granularity = properties.limits.bufferImageGranularity;
+
+    allocator->pools.resize(allocator->memory_properties.memoryTypeCount * 2);
+    for(uint32_t i = 0; i < allocator->pools.size(); i++)
+    {
+        vk_memory_pool& pool = allocator->pools[i];
+        pool.memory_type = i / 2;
+        pool.linear = i % 2;
+        pool.fl_bitmap = 0;
+        pool.allocated_bytes = 0;
+        pool.allocation_count = 0;
+        std::fill(std::begin(pool.sl_bitmap), std::end(pool.sl_bitmap), 0u);
+        for(uint32_t fl = 0; fl < VK_ALLOCATOR_FL_COUNT; fl++)
+        {
+            std::fill(std::begin(pool.free_heads[fl]), std::end(pool.free_heads[fl]), INVALID_INDEX);
+        }
+
+        // Don't let a single block take a big chunk of a small heap (e.g. the 256MB BAR heap)
+        const VkMemoryType& type = allocator->memory_properties.memoryTypes[pool.memory_type];
+        VkDeviceSize heap_size = allocator->memory_properties.memoryHeaps[type.heapIndex].size;
+        VkDeviceSize preferred = (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? VK_ALLOCATOR_HOST_BLOCK_SIZE : VK_ALLOCATOR_DEFAULT_BLOCK_SIZE;
+        pool.block_size = align_up(std::min(preferred, heap_size / 8), MIN_ALIGNMENT);
+
+        // Lazily allocated memory is only committed as tiles get touched, attachments get a block sized to themselves
+        if(type.propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) pool.block_size = 0;
+    }
+
+    return 0;
+}
+
+void vk_allocator_destroy(vk_allocator& allocator)
+{
+    for(vk_memory_pool& pool : allocator.pools)
+    {
+        if(pool.allocation_count > 0)
+        {
+            std::cerr << "Destroying allocator with " << pool.allocation_count << " live allocations in memory type " << pool.memory_type << std::endl;
+        }
+
+        for(vk_memory_block& block : pool.blocks)
+        {
+            if(block.memory == VK_NULL_HANDLE) continue;
+            if(block.mapped) vkUnmapMemory(allocator.device, block.memory);
+            vkFreeMemory(allocator.device, block.memory, NULL);
+        }
+    }
+
+    allocator.pools.clear();
+}
+
+int vk_allocator_find_memory_type(const vk_allocator& allocator, uint32_t type_bits, VkMemoryPropertyFlags properties)
+{
+    for(uint32_t i = 0; i < allocator.memory_properties.memoryTypeCount; i++)
+    {
+        if((type_bits & (1u << i)) && (allocator.memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int vk_allocator_alloc(vk_allocator& allocator, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, uint8_t linear, vk_allocation* allocation)
+{
+    if(allocation == NULL || requirements.size == 0) return -1;
+
+    int memory_type = vk_allocator_find_memory_type(allocator, requirements.memoryTypeBits, properties);
+    if(memory_type < 0)
+    {
+        std::cerr << "Failed to find suitable memory type" << std::endl;
+        return -1;
+    }
+
+    VkDeviceSize alignment = std::max(requirements.alignment, (VkDeviceSize)MIN_ALIGNMENT);
+    VkDeviceSize size = align_up(requirements.size, MIN_ALIGNMENT);
+    // Worst case padding needed to align the start of whatever free range we find
+    VkDeviceSize search_size = size + alignment - MIN_ALIGNMENT;
+
+    std::lock_guard<std::mutex> guard(allocator.lock);
+
+    uint32_t pool_index = memory_type * 2 + (linear ? 1 : 0);
+    vk_memory_pool& pool = allocator.pools[pool_index];
+
+    uint32_t index = find_free_node(pool, search_size);
+    if(index == INVALID_INDEX)
+    {
+        // Slow path, reserve another block from the driver
+        // (use its node directly, a block sized exactly to the request may sit below the rounded up search list)
+        index = pool_add_block(allocator, pool, search_size);
+        if(index == INVALID_INDEX) return -1;
+    }
+
+    free_list_remove(pool, index);
+
+    VkDeviceSize padding = align_up(pool.nodes[index].offset, alignment) - pool.nodes[index].offset;
+    if(padding > 0)
+    {
+        // The padding stays behind as a free range and the allocation starts at the node after it
+        node_split(pool, index, padding);
+        uint32_t padded = pool.nodes[index].next_physical;
+        free_list_remove(pool, padded);
+        free_list_insert(pool, index);
+        index = padded;
+    }
+
+    if(pool.nodes[index].size > size)
+    {
+        node_split(pool, index, size);
+    }
+
+    vk_memory_node& node = pool.nodes[index];
+    vk_memory_block& block = pool.blocks[node.block];
+
+    block.allocation_count++;
+    pool.allocation_count++;
+    pool.allocated_bytes += node.size;
+
+    allocation->memory = block.memory;
+    allocation->offset = node.offset;
+    allocation->size = node.size;
+    allocation->mapped = block.mapped ? (char*)block.mapped + node.offset : NULL;
+    allocation->memory_type = memory_type;
+    allocation->pool = pool_index;
+    allocation->node = index;
+
+    return 0;
+}
+
+void vk_allocator_free(vk_allocator& allocator, vk_allocation& allocation)
+{
+    if(allocation.memory == VK_NULL_HANDLE) return;
+
+    std::lock_guard<std::mutex> guard(allocator.lock);
+
+    vk_memory_pool& pool = allocator.pools[allocation.pool];
+    uint32_t index = allocation.node;
+
+    pool.blocks[pool.nodes[index].block].allocation_count--;
+    pool.allocation_count--;
+    pool.allocated_bytes -= pool.nodes[index].size;
+
+    uint32_t next = pool.nodes[index].next_physical;
+    if(next != INVALID_INDEX && pool.nodes[next].free)
+    {
+        free_list_remove(pool, next);
+        node_merge(pool, index, next);
+    }
+
+    uint32_t prev = pool.nodes[index].prev_physical;
+    if(prev != INVALID_INDEX && pool.nodes[prev].free)
+    {
+        free_list_remove(pool, prev);
+        node_merge(pool, prev, index);
+        index = prev;
+    }
+
+    free_list_insert(pool, index);
+
+    allocation = vk_allocation{};
+}
+
+void vk_allocator_trim(vk_allocator& allocator)
+{
+    std::lock_guard<std::mutex> guard(allocator.lock);
+
+    for(vk_memory_pool& pool : allocator.pools)
+    {
+        for(uint32_t i = 0; i < pool.nodes.size(); i++)
+        {
+            vk_memory_node& node = pool.nodes[i];
+            if(node.block == INVALID_INDEX || !node.free) continue;
+
+            // An empty block is a single free node spanning all of it
+            vk_memory_block& block = pool.blocks[node.block];
+            if(block.allocation_count > 0 || node.size != block.size) continue;
+
+            free_list_remove(pool, i);
+            node_release(pool, i);
+
+            if(block.mapped) vkUnmapMemory(allocator.device, block.memory);
+            vkFreeMemory(allocator.device, block.memory, NULL);
+            block = vk_memory_block{};
+        }
+    }
+}
+
+void vk_allocator_get_stats(vk_allocator& allocator, uint32_t memory_type, vk_allocator_stats* stats)
+{
+    if(stats == NULL) return;
+    *stats = vk_allocator_stats{};
+
+    std::lock_guard<std::mutex> guard(allocator.lock);
+
+    VkDeviceSize free_bytes = 0;
+    for(vk_memory_pool& pool : allocator.pools)
+    {
+        if(memory_type != UINT32_MAX && pool.memory_type != memory_type) continue;
+
+        for(vk_memory_block& block : pool.blocks)
+        {
+            if(block.memory == VK_NULL_HANDLE) continue;
+            stats->block_count++;
+            stats->reserved_bytes += block.size;
+        }
+
+        for(vk_memory_node& node : pool.nodes)
+        {
+            if(node.block == INVALID_INDEX || !node.free) continue;
+            stats->free_range_count++;
+            stats->largest_free_range = std::max(stats->largest_free_range, node.size);
+            free_bytes += node.size;
+        }
+
+        stats->allocation_count += pool.allocation_count;
+        stats->allocated_bytes += pool.allocated_bytes;
+    }
+
+    stats->fragmentation = free_bytes > 0 ? 1.0f - (float)((double)stats->largest_free_range / (double)free_bytes) : 0.0f;
+}
+
+void vk_allocator_print_stats(vk_allocator& allocator)
+{
+    for(uint32_t i = 0; i < allocator.memory_properties.memoryTypeCount; i++)
+    {
+        vk_allocator_stats stats;
+        vk_allocator_get_stats(allocator, i, &stats);
+        if(stats.block_count == 0) continue;
+
+        std::cout << "memory type " << i << ": " << stats.allocation_count << " allocations, "
+                  << stats.allocated_bytes / 1024 << " / " << stats.reserved_bytes / 1024 << " KiB in " << stats.block_count << " blocks, "
+                  << stats.free_range_count << " free ranges, fragmentation " << stats.fragmentation << std::endl;
+    }
+}
+
+int vk_buffer_create(vk_allocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, vk_buffer* buffer)
+{
+    if(buffer == NULL) return -1;
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // Lets the transfer and async compute queues write buffers the graphics queue reads without ownership transfers
+    if(allocator.buffer_queue_families.size() > 1)
+    {
+        buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buffer_info.queueFamilyIndexCount = allocator.buffer_queue_families.size();
+        buffer_info.pQueueFamilyIndices = allocator.buffer_queue_families.data();
+    }
+
+    if(vkCreateBuffer(allocator.device, &buffer_info, NULL, &buffer->buffer) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create buffer" << std::endl;
+        return -1;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(allocator.device, buffer->buffer, &requirements);
+
+    if(vk_allocator_alloc(allocator, requirements, properties, 1, &buffer->allocation) < 0)
+    {
+        vkDestroyBuffer(allocator.device, buffer->buffer, NULL);
+        return -1;
+    }
+
+    vkBindBufferMemory(allocator.device, buffer->buffer, buffer->allocation.memory, buffer->allocation.offset);
+    buffer->size = size;
+
+    return 0;
+}
+
+void vk_buffer_destroy(vk_allocator& allocator, vk_buffer& buffer)
+{
+    vkDestroyBuffer(allocator.device, buffer.buffer, NULL);
+    vk_allocator_free(allocator, buffer.allocation);
+    buffer.buffer = VK_NULL_HANDLE;
+}
+
+int vk_image_create(vk_allocator& allocator, const VkImageCreateInfo& image_info, VkMemoryPropertyFlags properties, vk_image* image)
+{
+    if(image == NULL) return -1;
+
+    if(vkCreateImage(allocator.device, &image_info, NULL, &image->image) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create image" << std::endl;
+        return -1;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(allocator.device, image->image, &requirements);
+
+    uint8_t linear = image_info.tiling == VK_IMAGE_TILING_LINEAR;
+    if(vk_allocator_alloc(allocator, requirements, properties, linear, &image->allocation) < 0)
+    {
+        vkDestroyImage(allocator.device, image->image, NULL);
+        return -1;
+    }
+
+    vkBindImageMemory(allocator.device, image->image, image->allocation.memory, image->allocation.offset);
+
+    return 0;
+}
+
+void vk_image_destroy(vk_allocator& allocator, vk_image& image)
+{
+    vkDestroyImage(allocator.device, image.image, NULL);
+    vk_allocator_free(allocator, image.allocation);
+    image.image = VK_NULL_HANDLE;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+
+// Device memory sub-allocator
+// Large VkDeviceMemory blocks are reserved per memory type and carved up with a TLSF (two level segregated fit) allocator.
+// Linear resources (buffers) and optimal tiling images live in separate pools so bufferImageGranularity never has to be
+// checked between neighbours. Allocation and free are O(1) and free never calls into the driver; empty blocks are only
+// handed back to the driver by vk_allocator_trim.
+
+#define VK_ALLOCATOR_SL_LOG2 5
+#define VK_ALLOCATOR_SL_COUNT (1 << VK_ALLOCATOR_SL_LOG2)
+#define VK_ALLOCATOR_FL_COUNT 32
+
+// Size of the blocks reserved from the driver (larger requests get a block of their own size)
+#define VK_ALLOCATOR_DEFAULT_BLOCK_SIZE (256ull * 1024 * 1024)
+#define VK_ALLOCATOR_HOST_BLOCK_SIZE (64ull * 1024 * 1024)
+
+struct vk_allocation
+{
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void* mapped;           // Persistently mapped pointer to offset when the memory is host visible, otherwise NULL
+    uint32_t memory_type;
+    uint32_t pool;
+    uint32_t node;
+};
+
+struct vk_memory_block
+{
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void* mapped;
+    uint32_t allocation_count;
+};
+
+// A free or used range within one of the pool's blocks
+struct vk_memory_node
+{
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    uint32_t block;
+    uint32_t prev_physical;
+    uint32_t next_physical;
+    uint32_t prev_free;
+    uint32_t next_free;
+    uint8_t free;
+};
+
+struct vk_memory_pool
+{
+    uint32_t memory_type;
+    uint8_t linear;
+    VkDeviceSize block_size;
+    std::vector<vk_memory_block> blocks;
+    std::vector<vk_memory_node> nodes;
+    std::vector<uint32_t> unused_nodes;
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[VK_ALLOCATOR_FL_COUNT];
+    uint32_t free_heads[VK_ALLOCATOR_FL_COUNT][VK_ALLOCATOR_SL_COUNT];
+    VkDeviceSize allocated_bytes;
+    uint32_t allocation_count;
+};
+
+struct vk_allocator
+{
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    VkDeviceSize buffer_image_granularity;
+    VkMemoryAllocateFlags allocate_flags;  // e.g. VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT when buffer device address is enabled
+    std::vector<uint32_t> buffer_queue_families;   // Buffers are created concurrent across these when there is more than one
+    std::vector<vk_memory_pool> pools;     // Two per memory type: [type * 2] optimal images, [type * 2 + 1] linear resources
+    std::mutex lock;
+};
+
+struct vk_allocator_stats
+{
+    uint32_t block_count;
+    uint32_t allocation_count;
+    uint32_t free_range_count;
+    VkDeviceSize reserved_bytes;    // Total size of all blocks reserved from the driver
+    VkDeviceSize allocated_bytes;
+    VkDeviceSize largest_free_range;
+    float fragmentation;            // 0 - all free memory is one contiguous range, approaching 1 - free memory is scattered
+};
+
+struct vk_buffer
+{
+    VkBuffer buffer;
+    vk_allocation allocation;
+    VkDeviceSize size;
+};
+
+struct vk_image
+{
+    VkImage image;
+    vk_allocation allocation;
+};
+
+int vk_allocator_create(VkPhysicalDevice physical_device, VkDevice device, vk_allocator* allocator);
+void vk_allocator_destroy(vk_allocator& allocator);
+
+// Sub-allocates memory satisfying requirements from a memory type with all of the required properties
+// linear should be 1 for buffers and linear tiling images and 0 for optimal tiling images
+// 0 - success
+// -1 - failure
+int vk_allocator_alloc(vk_allocator& allocator, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, uint8_t linear, vk_allocation* allocation);
+void vk_allocator_free(vk_allocator& allocator, vk_allocation& allocation);
+
+// Returns blocks with no live allocations to the driver
+void vk_allocator_trim(vk_allocator& allocator);
+
+// Stats for a single memory type or, with memory_type == UINT32_MAX, for every memory type combined
+void vk_allocator_get_stats(vk_allocator& allocator, uint32_t memory_type, vk_allocator_stats* stats);
+void vk_allocator_print_stats(vk_allocator& allocator);
+
+// Index of a memory type in type_bits with all of the given properties or -1
+int vk_allocator_find_memory_type(const vk_allocator& allocator, uint32_t type_bits, VkMemoryPropertyFlags properties);
+
+int vk_buffer_create(vk_allocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, vk_buffer* buffer);
+void vk_buffer_destroy(vk_allocator& allocator, vk_buffer& buffer);
+
+int vk_image_create(vk_allocator& allocator, const VkImageCreateInfo& image_info, VkMemoryPropertyFlags properties, vk_image* image);
+void vk_image_destroy(vk_allocator& allocator, vk_image& image);
@@ -0,0 +1,226 @@
+#include "vk_bindless.h"
+#include <iostream>
+#include <algorithm>
+
+static const VkDescriptorType descriptor_types[VK_BINDLESS_TYPE_COUNT] = { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+
+int vk_bindless_create(VkPhysicalDevice physical_device, VkDevice device, vk_bindless_heap* heap)
+{
+    if(heap == NULL) return -1;
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexing_properties{};
+    indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexing_properties;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+    // Every binding lives in the same set so the per stage limits cap each array as well
+    heap->capacity[VK_BINDLESS_SAMPLED_IMAGE] = std::min<uint32_t>({ VK_BINDLESS_MAX_SAMPLED_IMAGES,
+        indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages, indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+    heap->capacity[VK_BINDLESS_SAMPLER] = std::min<uint32_t>({ VK_BINDLESS_MAX_SAMPLERS,
+        indexing_properties.maxDescriptorSetUpdateAfterBindSamplers, indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers });
+    heap->capacity[VK_BINDLESS_STORAGE_BUFFER] = std::min<uint32_t>({ VK_BINDLESS_MAX_STORAGE_BUFFERS,
+        indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers, indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+    VkDescriptorSetLayoutBinding bindings[VK_BINDLESS_TYPE_COUNT]{};
+    VkDescriptorBindingFlags binding_flags[VK_BINDLESS_TYPE_COUNT];
+    VkDescriptorPoolSize pool_sizes[VK_BINDLESS_TYPE_COUNT];
+    for(uint32_t i = 0; i < VK_BINDLESS_TYPE_COUNT; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = descriptor_types[i];
+        bindings[i].descriptorCount = heap->capacity[i];
+        bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+
+        binding_flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+        pool_sizes[i].type = descriptor_types[i];
+        pool_sizes[i].descriptorCount = heap->capacity[i];
+
+        heap->next[i] = 0;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{};
+    binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    binding_flags_info.bindingCount = VK_BINDLESS_TYPE_COUNT;
+    binding_flags_info.pBindingFlags = binding_flags;
+
+    VkDescriptorSetLayoutCreateInfo set_layout_info{};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.pNext = &binding_flags_info;
+    set_layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    set_layout_info.bindingCount = VK_BINDLESS_TYPE_COUNT;
+    set_layout_info.pBindings = bindings;
+
+    if(vkCreateDescriptorSetLayout(device, &set_layout_info, NULL, &heap->set_layout) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create bindless descriptor set layout" << std::endl;
+        return -1;
+    }
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = VK_BINDLESS_TYPE_COUNT;
+    pool_info.pPoolSizes = pool_sizes;
+
+    if(vkCreateDescriptorPool(device, &pool_info, NULL, &heap->pool) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create bindless descriptor pool" << std::endl;
+        return -1;
+    }
+
+    VkDescriptorSetAllocateInfo set_info{};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = heap->pool;
+    set_info.descriptorSetCount = 1;
+    set_info.pSetLayouts = &heap->set_layout;
+
+    if(vkAllocateDescriptorSets(device, &set_info, &heap->set) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to allocate bindless descriptor set" << std::endl;
+        return -1;
+    }
+
+    VkPushConstantRange push_constants{};
+    push_constants.stageFlags = VK_SHADER_STAGE_ALL;
+    push_constants.offset = 0;
+    push_constants.size = VK_BINDLESS_PUSH_CONSTANT_SIZE;
+
+    VkPipelineLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &heap->set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_constants;
+
+    if(vkCreatePipelineLayout(device, &layout_info, NULL, &heap->pipeline_layout) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create bindless pipeline layout" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+void vk_bindless_destroy(VkDevice device, vk_bindless_heap& heap)
+{
+    vkDestroyPipelineLayout(device, heap.pipeline_layout, NULL);
+    vkDestroyDescriptorPool(device, heap.pool, NULL);
+    vkDestroyDescriptorSetLayout(device, heap.set_layout, NULL);
+
+    for(uint32_t i = 0; i < VK_BINDLESS_TYPE_COUNT; i++)
+    {
+        heap.free_indices[i].clear();
+    }
+    heap.retired.clear();
+}
+
+// Caller holds heap.lock
+static uint32_t allocate_index(vk_bindless_heap& heap, vk_bindless_type type)
+{
+    if(!heap.free_indices[type].empty())
+    {
+        uint32_t index = heap.free_indices[type].back();
+        heap.free_indices[type].pop_back();
+        return index;
+    }
+
+    if(heap.next[type] == heap.capacity[type])
+    {
+        std::cerr << "Bindless descriptor heap is full" << std::endl;
+        return VK_BINDLESS_INVALID_INDEX;
+    }
+
+    return heap.next[type]++;
+}
+
+static uint32_t write_descriptor(VkDevice device, vk_bindless_heap& heap, vk_bindless_type type, const VkDescriptorImageInfo* image_info, const VkDescriptorBufferInfo* buffer_info)
+{
+    // Updates to the set have to be externally synchronized, so the write happens under the lock too
+    std::lock_guard<std::mutex> guard(heap.lock);
+
+    uint32_t index = allocate_index(heap, type);
+    if(index == VK_BINDLESS_INVALID_INDEX) return index;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = heap.set;
+    write.dstBinding = type;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = descriptor_types[type];
+    write.pImageInfo = image_info;
+    write.pBufferInfo = buffer_info;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+
+    return index;
+}
+
+uint32_t vk_bindless_add_image(VkDevice device, vk_bindless_heap& heap, VkImageView view, VkImageLayout layout)
+{
+    VkDescriptorImageInfo image_info{};
+    image_info.imageView = view;
+    image_info.imageLayout = layout;
+
+    return write_descriptor(device, heap, VK_BINDLESS_SAMPLED_IMAGE, &image_info, NULL);
+}
+
+uint32_t vk_bindless_add_sampler(VkDevice device, vk_bindless_heap& heap, VkSampler sampler)
+{
+    VkDescriptorImageInfo image_info{};
+    image_info.sampler = sampler;
+
+    return write_descriptor(device, heap, VK_BINDLESS_SAMPLER, &image_info, NULL);
+}
+
+uint32_t vk_bindless_add_buffer(VkDevice device, vk_bindless_heap& heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    VkDescriptorBufferInfo buffer_info{};
+    buffer_info.buffer = buffer;
+    buffer_info.offset = offset;
+    buffer_info.range = range;
+
+    return write_descriptor(device, heap, VK_BINDLESS_STORAGE_BUFFER, NULL, &buffer_info);
+}
+
+void vk_bindless_remove(vk_bindless_heap& heap, vk_bindless_type type, uint32_t index, uint64_t serial)
+{
+    if(index == VK_BINDLESS_INVALID_INDEX) return;
+
+    std::lock_guard<std::mutex> guard(heap.lock);
+    heap.retired.push_back(vk_bindless_retired{ type, index, serial });
+}
+
+void vk_bindless_collect(vk_bindless_heap& heap, uint64_t completed_serial)
+{
+    std::lock_guard<std::mutex> guard(heap.lock);
+
+    for(size_t i = 0; i < heap.retired.size();)
+    {
+        if(heap.retired[i].serial <= completed_serial)
+        {
+            heap.free_indices[heap.retired[i].type].push_back(heap.retired[i].index);
+            heap.retired[i] = heap.retired.back();
+            heap.retired.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void vk_bindless_bind(VkCommandBuffer cmd, const vk_bindless_heap& heap, VkPipelineBindPoint bind_point)
+{
+    vkCmdBindDescriptorSets(cmd, bind_point, heap.pipeline_layout, 0, 1, &heap.set, 0, NULL);
+}
+
+void vk_bindless_push(VkCommandBuffer cmd, const vk_bindless_heap& heap, const void* data, uint32_t size)
+{
+    vkCmdPushConstants(cmd, heap.pipeline_layout, VK_SHADER_STAGE_ALL, 0, size, data);
+}
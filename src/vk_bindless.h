@@ -0,0 +1,71 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+
+// Global bindless descriptor heap
+// One update-after-bind descriptor set holds large partially bound arrays of every resource type and one pipeline layout
+// (that set + a push constant range) is shared by every pipeline. Shaders index the arrays with integers passed through
+// push constants / buffers, so a command buffer binds the set once and never touches descriptors per draw.
+//
+// GLSL side (GL_EXT_nonuniform_qualifier):
+//   layout(set = 0, binding = 0) uniform texture2D textures[];
+//   layout(set = 0, binding = 1) uniform sampler samplers[];
+//   layout(set = 0, binding = 2) buffer storage_buffers { uint data[]; } buffers[];
+//   layout(push_constant) uniform constants { ... };    // Up to VK_BINDLESS_PUSH_CONSTANT_SIZE bytes
+
+// Upper bounds, clamped to the device's update after bind limits
+#define VK_BINDLESS_MAX_SAMPLED_IMAGES 16384
+#define VK_BINDLESS_MAX_SAMPLERS 256
+#define VK_BINDLESS_MAX_STORAGE_BUFFERS 16384
+
+// The minimum maxPushConstantsSize every device guarantees
+#define VK_BINDLESS_PUSH_CONSTANT_SIZE 128
+
+#define VK_BINDLESS_INVALID_INDEX UINT32_MAX
+
+enum vk_bindless_type
+{
+    VK_BINDLESS_SAMPLED_IMAGE = 0,
+    VK_BINDLESS_SAMPLER = 1,
+    VK_BINDLESS_STORAGE_BUFFER = 2,
+    VK_BINDLESS_TYPE_COUNT = 3
+};
+
+// Index released with vk_bindless_remove that can be reused once the frame with serial has completed
+struct vk_bindless_retired
+{
+    vk_bindless_type type;
+    uint32_t index;
+    uint64_t serial;
+};
+
+struct vk_bindless_heap
+{
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+    VkPipelineLayout pipeline_layout;
+    uint32_t capacity[VK_BINDLESS_TYPE_COUNT];
+    uint32_t next[VK_BINDLESS_TYPE_COUNT];              // Indices below next have been handed out at some point
+    std::vector<uint32_t> free_indices[VK_BINDLESS_TYPE_COUNT];
+    std::vector<vk_bindless_retired> retired;
+    std::mutex lock;
+};
+
+int vk_bindless_create(VkPhysicalDevice physical_device, VkDevice device, vk_bindless_heap* heap);
+void vk_bindless_destroy(VkDevice device, vk_bindless_heap& heap);
+
+// Write a resource into a free slot and return its index (VK_BINDLESS_INVALID_INDEX when the array is full)
+// Slots can be written while the set is bound in command buffers that don't use them (update after bind)
+uint32_t vk_bindless_add_image(VkDevice device, vk_bindless_heap& heap, VkImageView view, VkImageLayout layout);
+uint32_t vk_bindless_add_sampler(VkDevice device, vk_bindless_heap& heap, VkSampler sampler);
+uint32_t vk_bindless_add_buffer(VkDevice device, vk_bindless_heap& heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+// Releases index once the frame with serial (the last one that may use it) has completed, see vk_bindless_collect
+void vk_bindless_remove(vk_bindless_heap& heap, vk_bindless_type type, uint32_t index, uint64_t serial);
+void vk_bindless_collect(vk_bindless_heap& heap, uint64_t completed_serial);
+
+// Binds the heap to set 0, once per command buffer (secondaries included) and bind point
+void vk_bindless_bind(VkCommandBuffer cmd, const vk_bindless_heap& heap, VkPipelineBindPoint bind_point);
+void vk_bindless_push(VkCommandBuffer cmd, const vk_bindless_heap& heap, const void* data, uint32_t size);
@@ -0,0 +1,160 @@
+#include "vk_cpu_profiler.h"
+
+#ifdef VK_CPU_PROFILER
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <new>
+
+std::atomic<bool> vk_cpu_profiler_enabled(false);
+
+struct cpu_zone_entry
+{
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+};
+
+// Written by its thread only (head), read by the drain thread only (tail)
+struct cpu_thread_ring
+{
+    cpu_zone_entry entries[VK_CPU_PROFILER_RING_SIZE];
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+    uint32_t tid;
+};
+
+struct cpu_profiler_state
+{
+    std::mutex rings_mutex;                 // Guards the list, taken once per thread and by each drain
+    std::vector<cpu_thread_ring*> rings;
+    std::thread drain_thread;
+    std::atomic<bool> draining;
+    std::vector<vk_trace_event> events;     // Drain thread only while it runs
+    uint64_t dropped;
+};
+
+static cpu_profiler_state state;
+static thread_local cpu_thread_ring* thread_ring = NULL;
+
+static cpu_thread_ring* register_thread()
+{
+    cpu_thread_ring* ring = new(std::nothrow) cpu_thread_ring;
+    if(ring == NULL) return NULL;
+
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->dropped.store(0, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(state.rings_mutex);
+    ring->tid = state.rings.size();
+    state.rings.push_back(ring);
+
+    return ring;
+}
+
+void vk_cpu_zone_record(const char* name, std::chrono::steady_clock::time_point start)
+{
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    // Zones still open when the profiler stopped are dropped rather than left for the next capture
+    if(!vk_cpu_profiler_enabled.load(std::memory_order_relaxed)) return;
+
+    if(thread_ring == NULL)
+    {
+        thread_ring = register_thread();
+        if(thread_ring == NULL) return;
+    }
+
+    uint64_t head = thread_ring->head.load(std::memory_order_relaxed);
+    if(head - thread_ring->tail.load(std::memory_order_acquire) >= VK_CPU_PROFILER_RING_SIZE)
+    {
+        thread_ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    cpu_zone_entry& entry = thread_ring->entries[head & (VK_CPU_PROFILER_RING_SIZE - 1)];
+    entry.name = name;
+    entry.start = start;
+    entry.end = end;
+
+    thread_ring->head.store(head + 1, std::memory_order_release);
+}
+
+static void drain_rings()
+{
+    std::lock_guard<std::mutex> lock(state.rings_mutex);
+
+    for(cpu_thread_ring* ring : state.rings)
+    {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+
+        for(; tail != head; tail++)
+        {
+            const cpu_zone_entry& entry = ring->entries[tail & (VK_CPU_PROFILER_RING_SIZE - 1)];
+
+            vk_trace_event event;
+            event.name = entry.name;
+            event.category = "cpu";
+            event.pid = VK_TRACE_PID_CPU;
+            event.tid = ring->tid;
+            event.start_us = vk_trace_time_us(entry.start);
+            event.duration_us = std::chrono::duration<double, std::micro>(entry.end - entry.start).count();
+            state.events.push_back(event);
+        }
+
+        ring->tail.store(tail, std::memory_order_release);
+        state.dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+}
+
+static void drain_loop()
+{
+    while(state.draining.load(std::memory_order_acquire))
+    {
+        drain_rings();
+        std::this_thread::sleep_for(std::chrono::milliseconds(VK_CPU_PROFILER_DRAIN_INTERVAL_MS));
+    }
+}
+
+void vk_cpu_profiler_start()
+{
+    if(state.drain_thread.joinable()) return;
+
+    // Pins the trace timeline's origin before the first zone
+    vk_trace_now_us();
+
+    // Whatever an earlier capture left behind isn't part of this one
+    drain_rings();
+    state.events.clear();
+    state.dropped = 0;
+
+    state.draining.store(true, std::memory_order_release);
+    state.drain_thread = std::thread(drain_loop);
+    vk_cpu_profiler_enabled.store(true, std::memory_order_release);
+}
+
+void vk_cpu_profiler_stop(vk_trace* trace)
+{
+    if(!state.drain_thread.joinable()) return;
+
+    vk_cpu_profiler_enabled.store(false, std::memory_order_release);
+    state.draining.store(false, std::memory_order_release);
+    state.drain_thread.join();
+    drain_rings();
+
+    if(trace != NULL)
+    {
+        trace->events.insert(trace->events.end(), state.events.begin(), state.events.end());
+        if(state.dropped > 0)
+        {
+            vk_trace_add(*trace, "dropped " + std::to_string(state.dropped) + " zones", "cpu", VK_TRACE_PID_CPU, 0, vk_trace_now_us(), 0.0, "");
+        }
+    }
+    state.events.clear();
+}
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include "vk_trace.h"
+
+// CPU zones
+// VK_CPU_ZONE("name") times the rest of the enclosing scope. Every thread writes its zones into its own single producer
+// ring (registered under a lock on the thread's first zone, kept until the process exits), after that recording takes
+// no locks and never waits on another thread: a full ring drops the zone. A drain thread started by
+// vk_cpu_profiler_start empties the rings every few milliseconds and converts the zones into trace events,
+// vk_cpu_profiler_stop hands them over.
+// Zones are read on steady_clock rather than rdtsc so they share vk_trace's timeline with the GPU regions.
+// Builds without VK_CPU_PROFILER (the REN_CPU_PROFILER CMake option) compile zones and the API below to nothing,
+// with it a zone costs one relaxed load until the profiler is started.
+// Zone names must be string literals (or otherwise outlive the capture), only the pointer is stored.
+
+#define VK_CPU_PROFILER_RING_SIZE 16384     // Zones per thread between drains, power of two
+#define VK_CPU_PROFILER_DRAIN_INTERVAL_MS 4
+
+#ifdef VK_CPU_PROFILER
+
+extern std::atomic<bool> vk_cpu_profiler_enabled;
+
+void vk_cpu_zone_record(const char* name, std::chrono::steady_clock::time_point start);
+
+struct vk_cpu_zone
+{
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+    uint8_t active;
+
+    explicit vk_cpu_zone(const char* zone_name) : name(zone_name), active(vk_cpu_profiler_enabled.load(std::memory_order_relaxed))
+    {
+        if(active) start = std::chrono::steady_clock::now();
+    }
+
+    ~vk_cpu_zone()
+    {
+        if(active) vk_cpu_zone_record(name, start);
+    }
+};
+
+#define VK_CPU_ZONE_CONCAT_INNER(a, b) a##b
+#define VK_CPU_ZONE_CONCAT(a, b) VK_CPU_ZONE_CONCAT_INNER(a, b)
+#define VK_CPU_ZONE(name) vk_cpu_zone VK_CPU_ZONE_CONCAT(vk_cpu_zone_, __LINE__)(name)
+
+// Enables zones and starts the drain thread
+void vk_cpu_profiler_start();
+
+// Disables zones, drains what's left and appends every zone recorded since vk_cpu_profiler_start to trace (may be NULL)
+// Zones still open when it's called are dropped
+void vk_cpu_profiler_stop(vk_trace* trace);
+
+#else
+
+#define VK_CPU_ZONE(name) ((void)0)
+
+inline void vk_cpu_profiler_start() {}
+inline void vk_cpu_profiler_stop(vk_trace* trace) {}
+
+#endif
@@ -0,0 +1,296 @@
+#include "vk_cull.h"
+#include "vk_cpu_profiler.h"
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VK_CULL_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(VK_CULL_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Every kernel culls objects [begin, end) of set, writes the visible ids to out and returns how many there were
+typedef uint32_t (*cull_kernel)(const vk_cull_set& set, const float planes[6][4], uint32_t begin, uint32_t end, uint32_t* out);
+
+#ifdef VK_CULL_AVX2
+// vk_cull_avx2.cpp, the only file built with AVX2 code generation. Only handles whole groups of 8 objects.
+uint32_t vk_cull_kernel_avx2(const vk_cull_set& set, const float planes[6][4], uint32_t begin, uint32_t end, uint32_t* out);
+#endif
+
+static uint32_t cull_scalar(const vk_cull_set& set, const float planes[6][4], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    uint32_t count = 0;
+    for(uint32_t i = begin; i < end; i++)
+    {
+        uint32_t inside = 1;
+        for(uint32_t p = 0; p < 6; p++)
+        {
+            const float* plane = planes[p];
+
+            float distance = plane[0] * set.center_x[i] + plane[1] * set.center_y[i] + plane[2] * set.center_z[i] + plane[3];
+            inside &= distance >= -set.radius[i];
+
+            // Corner of the box furthest along the plane normal, if that one is outside the whole box is
+            float x = plane[0] > 0.0f ? set.max_x[i] : set.min_x[i];
+            float y = plane[1] > 0.0f ? set.max_y[i] : set.min_y[i];
+            float z = plane[2] > 0.0f ? set.max_z[i] : set.min_z[i];
+            inside &= plane[0] * x + plane[1] * y + plane[2] * z + plane[3] >= 0.0f;
+        }
+
+        // Written unconditionally and only kept when visible, no branch on the result
+        out[count] = set.ids[i];
+        count += inside;
+    }
+
+    return count;
+}
+
+#ifdef VK_CULL_SSE2
+static uint32_t cull_sse2(const vk_cull_set& set, const float planes[6][4], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    uint32_t count = 0;
+    uint32_t i = begin;
+    for(; i + 4 <= end; i += 4)
+    {
+        __m128 center_x = _mm_loadu_ps(&set.center_x[i]);
+        __m128 center_y = _mm_loadu_ps(&set.center_y[i]);
+        __m128 center_z = _mm_loadu_ps(&set.center_z[i]);
+        __m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&set.radius[i]));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for(uint32_t p = 0; p < 6; p++)
+        {
+            const float* plane = planes[p];
+            __m128 plane_x = _mm_set1_ps(plane[0]);
+            __m128 plane_y = _mm_set1_ps(plane[1]);
+            __m128 plane_z = _mm_set1_ps(plane[2]);
+            __m128 plane_w = _mm_set1_ps(plane[3]);
+
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x, center_x), _mm_mul_ps(plane_y, center_y)),
+                                         _mm_add_ps(_mm_mul_ps(plane_z, center_z), plane_w));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+
+            // The corner choice only depends on the plane so it is the same for every lane
+            __m128 x = _mm_loadu_ps(plane[0] > 0.0f ? &set.max_x[i] : &set.min_x[i]);
+            __m128 y = _mm_loadu_ps(plane[1] > 0.0f ? &set.max_y[i] : &set.min_y[i]);
+            __m128 z = _mm_loadu_ps(plane[2] > 0.0f ? &set.max_z[i] : &set.min_z[i]);
+            __m128 corner = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x, x), _mm_mul_ps(plane_y, y)),
+                                       _mm_add_ps(_mm_mul_ps(plane_z, z), plane_w));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(corner, _mm_setzero_ps()));
+        }
+
+        uint32_t mask = _mm_movemask_ps(inside);
+        if(mask == 0) continue;
+
+        for(uint32_t lane = 0; lane < 4; lane++)
+        {
+            out[count] = set.ids[i + lane];
+            count += (mask >> lane) & 1;
+        }
+    }
+
+    return count + cull_scalar(set, planes, i, end, out + count);
+}
+#endif
+
+#ifdef VK_CULL_AVX2
+static uint32_t cull_avx2(const vk_cull_set& set, const float planes[6][4], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    uint32_t simd_end = begin + (end - begin) / 8 * 8;
+    uint32_t count = vk_cull_kernel_avx2(set, planes, begin, simd_end, out);
+    return count + cull_scalar(set, planes, simd_end, end, out + count);
+}
+
+static bool cpu_supports_avx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7) return false;
+
+    // The OS has to save the YMM registers too (OSXSAVE + XCR0 bits 1 and 2)
+    __cpuid(info, 1);
+    if(!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+struct cull_dispatch
+{
+    cull_kernel kernel;
+    const char* name;
+};
+
+static cull_dispatch select_kernel()
+{
+#ifdef VK_CULL_AVX2
+    if(cpu_supports_avx2()) return cull_dispatch{ cull_avx2, "avx2" };
+#endif
+#ifdef VK_CULL_SSE2
+    return cull_dispatch{ cull_sse2, "sse2" };
+#else
+    return cull_dispatch{ cull_scalar, "scalar" };
+#endif
+}
+
+static const cull_dispatch& get_kernel()
+{
+    static const cull_dispatch dispatch = select_kernel();
+    return dispatch;
+}
+
+const char* vk_cull_kernel_name()
+{
+    return get_kernel().name;
+}
+
+uint32_t vk_cull_set_add(vk_cull_set& set, const float center[3], float radius, const float min[3], const float max[3], uint32_t id)
+{
+    set.center_x.push_back(center[0]);
+    set.center_y.push_back(center[1]);
+    set.center_z.push_back(center[2]);
+    set.radius.push_back(radius);
+    set.min_x.push_back(min[0]);
+    set.min_y.push_back(min[1]);
+    set.min_z.push_back(min[2]);
+    set.max_x.push_back(max[0]);
+    set.max_y.push_back(max[1]);
+    set.max_z.push_back(max[2]);
+    set.ids.push_back(id);
+
+    return set.ids.size() - 1;
+}
+
+uint32_t vk_cull_set_add_sphere(vk_cull_set& set, const float center[3], float radius, uint32_t id)
+{
+    float min[3] = { center[0] - radius, center[1] - radius, center[2] - radius };
+    float max[3] = { center[0] + radius, center[1] + radius, center[2] + radius };
+    return vk_cull_set_add(set, center, radius, min, max, id);
+}
+
+void vk_cull_set_update(vk_cull_set& set, uint32_t index, const float center[3], float radius, const float min[3], const float max[3])
+{
+    set.center_x[index] = center[0];
+    set.center_y[index] = center[1];
+    set.center_z[index] = center[2];
+    set.radius[index] = radius;
+    set.min_x[index] = min[0];
+    set.min_y[index] = min[1];
+    set.min_z[index] = min[2];
+    set.max_x[index] = max[0];
+    set.max_y[index] = max[1];
+    set.max_z[index] = max[2];
+}
+
+void vk_cull_set_clear(vk_cull_set& set)
+{
+    set.center_x.clear();
+    set.center_y.clear();
+    set.center_z.clear();
+    set.radius.clear();
+    set.min_x.clear();
+    set.min_y.clear();
+    set.min_z.clear();
+    set.max_x.clear();
+    set.max_y.clear();
+    set.max_z.clear();
+    set.ids.clear();
+    set.visible.clear();
+}
+
+uint32_t vk_cull_frustum(vk_cull_set& set, vk_job_system* jobs, const float planes[6][4])
+{
+    VK_CPU_ZONE("vk_cull_frustum");
+
+    uint32_t object_count = set.ids.size();
+    cull_kernel kernel = get_kernel().kernel;
+
+    // Kernels write up to one id per object tested
+    set.visible.resize(object_count);
+
+    if(jobs == NULL || object_count <= VK_CULL_CHUNK_SIZE)
+    {
+        uint32_t visible_count = kernel(set, planes, 0, object_count, set.visible.data());
+        set.visible.resize(visible_count);
+        return visible_count;
+    }
+
+    // Chunks cull into their own slice of scratch, then get packed back to back into visible
+    uint32_t chunk_count = (object_count + VK_CULL_CHUNK_SIZE - 1) / VK_CULL_CHUNK_SIZE;
+    set.scratch.resize(object_count);
+    set.chunk_counts.resize(chunk_count + 1);
+
+    vk_job_parallel_for(*jobs, chunk_count, 1, [&](uint32_t begin, uint32_t end, uint32_t thread)
+    {
+        for(uint32_t chunk = begin; chunk < end; chunk++)
+        {
+            uint32_t first = chunk * VK_CULL_CHUNK_SIZE;
+            uint32_t last = first + VK_CULL_CHUNK_SIZE < object_count ? first + VK_CULL_CHUNK_SIZE : object_count;
+            set.chunk_counts[chunk] = kernel(set, planes, first, last, set.scratch.data() + first);
+        }
+    });
+
+    // Exclusive prefix sum, chunk_counts[chunk_count] ends up as the total
+    uint32_t visible_count = 0;
+    for(uint32_t chunk = 0; chunk <= chunk_count; chunk++)
+    {
+        uint32_t count = chunk < chunk_count ? set.chunk_counts[chunk] : 0;
+        set.chunk_counts[chunk] = visible_count;
+        visible_count += count;
+    }
+
+    vk_job_parallel_for(*jobs, chunk_count, 1, [&](uint32_t begin, uint32_t end, uint32_t thread)
+    {
+        for(uint32_t chunk = begin; chunk < end; chunk++)
+        {
+            uint32_t offset = set.chunk_counts[chunk];
+            uint32_t count = set.chunk_counts[chunk + 1] - offset;
+            if(count > 0) memcpy(set.visible.data() + offset, set.scratch.data() + chunk * VK_CULL_CHUNK_SIZE, count * sizeof(uint32_t));
+        }
+    });
+
+    set.visible.resize(visible_count);
+    return visible_count;
+}
+
+void vk_frustum_planes(const float view_projection[16], float planes[6][4])
+{
+    // Gribb / Hartmann: each plane is the last row of the matrix plus or minus one of the others
+    const float* m = view_projection;
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        float row0 = m[i * 4 + 0];
+        float row1 = m[i * 4 + 1];
+        float row2 = m[i * 4 + 2];
+        float row3 = m[i * 4 + 3];
+
+        planes[0][i] = row3 + row0;
+        planes[1][i] = row3 - row0;
+        planes[2][i] = row3 + row1;
+        planes[3][i] = row3 - row1;
+        planes[4][i] = row2;
+        planes[5][i] = row3 - row2;
+    }
+
+    // Normalized so the sphere test can compare distances against radii directly
+    // Projections that ignore z (e.g. 2D) leave the near / far planes without a normal, those accept everything as long as w >= 0
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        float length = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        if(length > 0.0f)
+        {
+            planes[i][0] /= length;
+            planes[i][1] /= length;
+            planes[i][2] /= length;
+            planes[i][3] /= length;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "vk_jobs.h"
+
+// CPU frustum culling
+// Object bounds are kept as structure of arrays (one array per component) so the kernels load 4 / 8 objects per
+// instruction. Every object has a bounding sphere and an axis aligned box, the sphere rejects most objects and the box
+// tightens the result for long / flat ones. Kernels are picked at runtime: AVX2 when the binary was built with it
+// (VK_CULL_AVX2, see CMakeLists.txt) and the CPU supports it, then SSE2, then plain scalar code.
+// Large sets are split into VK_CULL_CHUNK_SIZE chunks culled on the job system, the output is the ids of the visible
+// objects in the order they were added.
+
+#define VK_CULL_CHUNK_SIZE 4096
+
+struct vk_cull_set
+{
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> radius;
+    std::vector<float> min_x;
+    std::vector<float> min_y;
+    std::vector<float> min_z;
+    std::vector<float> max_x;
+    std::vector<float> max_y;
+    std::vector<float> max_z;
+    std::vector<uint32_t> ids;          // Caller's id for every object, what ends up in visible
+    std::vector<uint32_t> visible;      // Result of the last vk_cull_frustum
+    std::vector<uint32_t> scratch;      // Per chunk results before they are compacted into visible
+    std::vector<uint32_t> chunk_counts;
+};
+
+// Returns the object's index in the set (for vk_cull_set_update)
+uint32_t vk_cull_set_add(vk_cull_set& set, const float center[3], float radius, const float min[3], const float max[3], uint32_t id);
+
+// Sphere only objects, the box is the cube around the sphere
+uint32_t vk_cull_set_add_sphere(vk_cull_set& set, const float center[3], float radius, uint32_t id);
+
+void vk_cull_set_update(vk_cull_set& set, uint32_t index, const float center[3], float radius, const float min[3], const float max[3]);
+void vk_cull_set_clear(vk_cull_set& set);
+
+// Tests every object against planes and fills set.visible with the ids of the ones that are at least partially inside
+// jobs may be NULL to cull on the calling thread, must not be called from inside a job
+// Returns the number of visible objects
+uint32_t vk_cull_frustum(vk_cull_set& set, vk_job_system* jobs, const float planes[6][4]);
+
+// Name of the kernel vk_cull_frustum uses on this machine ("avx2", "sse2" or "scalar")
+const char* vk_cull_kernel_name();
+
+// Extracts the 6 frustum planes (left, right, bottom, top, near, far) from a column major view projection matrix
+// using Vulkan's 0..1 depth range. Planes point inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0
+void vk_frustum_planes(const float view_projection[16], float planes[6][4]);
@@ -0,0 +1,51 @@
+#include "vk_cull.h"
+
+// AVX2 culling kernel, the only code built with AVX2 enabled so the rest of the binary still runs on older CPUs
+// vk_cull.cpp only calls it after checking the CPU supports AVX2 (see the kernel selection there)
+#ifdef VK_CULL_AVX2
+#include <immintrin.h>
+
+uint32_t vk_cull_kernel_avx2(const vk_cull_set& set, const float planes[6][4], uint32_t begin, uint32_t end, uint32_t* out)
+{
+    uint32_t count = 0;
+    for(uint32_t i = begin; i + 8 <= end; i += 8)
+    {
+        __m256 center_x = _mm256_loadu_ps(&set.center_x[i]);
+        __m256 center_y = _mm256_loadu_ps(&set.center_y[i]);
+        __m256 center_z = _mm256_loadu_ps(&set.center_z[i]);
+        __m256 negative_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&set.radius[i]));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for(uint32_t p = 0; p < 6; p++)
+        {
+            const float* plane = planes[p];
+            __m256 plane_x = _mm256_set1_ps(plane[0]);
+            __m256 plane_y = _mm256_set1_ps(plane[1]);
+            __m256 plane_z = _mm256_set1_ps(plane[2]);
+            __m256 plane_w = _mm256_set1_ps(plane[3]);
+
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x, center_x), _mm256_mul_ps(plane_y, center_y)),
+                                            _mm256_add_ps(_mm256_mul_ps(plane_z, center_z), plane_w));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ));
+
+            __m256 x = _mm256_loadu_ps(plane[0] > 0.0f ? &set.max_x[i] : &set.min_x[i]);
+            __m256 y = _mm256_loadu_ps(plane[1] > 0.0f ? &set.max_y[i] : &set.min_y[i]);
+            __m256 z = _mm256_loadu_ps(plane[2] > 0.0f ? &set.max_z[i] : &set.min_z[i]);
+            __m256 corner = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x, x), _mm256_mul_ps(plane_y, y)),
+                                          _mm256_add_ps(_mm256_mul_ps(plane_z, z), plane_w));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(corner, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        uint32_t mask = _mm256_movemask_ps(inside);
+        if(mask == 0) continue;
+
+        for(uint32_t lane = 0; lane < 8; lane++)
+        {
+            out[count] = set.ids[i + lane];
+            count += (mask >> lane) & 1;
+        }
+    }
+
+    return count;
+}
+#endif
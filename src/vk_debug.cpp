@@ -0,0 +1,154 @@
+#include "vk_debug.h"
+
+#ifdef VK_DEBUG_LAYERS
+
+#include <iostream>
+#include <cstring>
+#include <new>
+
+// Number of times id was seen including this one, 0 when the rate limiter's table is full (never limited)
+static uint32_t count_occurrence(vk_debug_log* log, int32_t id)
+{
+    uint64_t key = (uint64_t)(uint32_t)id | (1ull << 32);
+    uint32_t slot = ((uint32_t)id * 2654435761u) & (VK_DEBUG_REPEAT_SLOTS - 1);
+
+    for(uint32_t probe = 0; probe < VK_DEBUG_REPEAT_SLOTS; probe++)
+    {
+        uint64_t current = log->repeat_keys[slot].load(std::memory_order_acquire);
+        if(current == 0)
+        {
+            // Another thread may claim the slot first, possibly for the same id
+            log->repeat_keys[slot].compare_exchange_strong(current, key, std::memory_order_acq_rel);
+            if(current == 0) current = key;
+        }
+
+        if(current == key)
+        {
+            return log->repeat_counts[slot].fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        slot = (slot + 1) & (VK_DEBUG_REPEAT_SLOTS - 1);
+    }
+
+    return 0;
+}
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL debug_log_callback(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+                                                         const VkDebugUtilsMessengerCallbackDataEXT* data, void* user_data)
+{
+    vk_debug_log* log = (vk_debug_log*)user_data;
+
+    // Past the limit only occurrences 16, 32, 64, ... get through so a message repeated every frame stays visible without flooding
+    uint32_t occurrence = count_occurrence(log, data->messageIdNumber);
+    if(occurrence > log->config.repeat_limit && (occurrence & (occurrence - 1)) != 0)
+    {
+        return VK_FALSE;
+    }
+
+    // Bounded multi producer ring, a slot's sequence says whether it's free for position pos (== pos) or still holds
+    // a message the flush hasn't read yet (< pos)
+    uint64_t pos = log->head.load(std::memory_order_relaxed);
+    vk_debug_message* message;
+    for(;;)
+    {
+        message = &log->messages[pos & (VK_DEBUG_LOG_CAPACITY - 1)];
+        int64_t difference = (int64_t)(message->sequence.load(std::memory_order_acquire) - pos);
+        if(difference == 0)
+        {
+            if(log->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if(difference < 0)
+        {
+            log->dropped.fetch_add(1, std::memory_order_relaxed);
+            return VK_FALSE;
+        }
+        else
+        {
+            pos = log->head.load(std::memory_order_relaxed);
+        }
+    }
+
+    message->severity = severity;
+    message->occurrence = occurrence;
+    const char* text = data->pMessage != NULL ? data->pMessage : "";
+    strncpy(message->text, text, VK_DEBUG_LOG_MESSAGE_SIZE - 1);
+    message->text[VK_DEBUG_LOG_MESSAGE_SIZE - 1] = '\0';
+
+    message->sequence.store(pos + 1, std::memory_order_release);
+
+    return VK_FALSE;
+}
+
+vk_debug_log* vk_debug_log_create(const vk_debug_config& config)
+{
+    vk_debug_log* log = new(std::nothrow) vk_debug_log;
+    if(log == NULL) return NULL;
+
+    log->config = config;
+    for(uint32_t i = 0; i < VK_DEBUG_LOG_CAPACITY; i++)
+    {
+        log->messages[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    log->head.store(0, std::memory_order_relaxed);
+    log->tail = 0;
+    for(uint32_t i = 0; i < VK_DEBUG_REPEAT_SLOTS; i++)
+    {
+        log->repeat_keys[i].store(0, std::memory_order_relaxed);
+        log->repeat_counts[i].store(0, std::memory_order_relaxed);
+    }
+    log->dropped.store(0, std::memory_order_relaxed);
+
+    return log;
+}
+
+void vk_debug_log_destroy(vk_debug_log* log)
+{
+    delete log;
+}
+
+void vk_debug_log_messenger_info(vk_debug_log* log, VkDebugUtilsMessengerCreateInfoEXT* info)
+{
+    info->sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+    info->messageSeverity = log->config.severities;
+    info->messageType = log->config.types;
+    info->pfnUserCallback = debug_log_callback;
+    info->pUserData = log;
+}
+
+static const char* severity_name(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+{
+    if(severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) return "error";
+    if(severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) return "warning";
+    if(severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) return "info";
+    return "verbose";
+}
+
+void vk_debug_log_flush(vk_debug_log* log)
+{
+    if(log == NULL) return;
+
+    for(;;)
+    {
+        vk_debug_message& message = log->messages[log->tail & (VK_DEBUG_LOG_CAPACITY - 1)];
+        if(message.sequence.load(std::memory_order_acquire) != log->tail + 1) break;
+
+        std::cerr << "validation layer (" << severity_name(message.severity) << "): " << message.text;
+        if(message.occurrence > log->config.repeat_limit)
+        {
+            std::cerr << " [seen " << message.occurrence << " times]";
+        }
+        std::cerr << std::endl;
+
+        // Hands the slot back to producers for the position one lap later
+        message.sequence.store(log->tail + VK_DEBUG_LOG_CAPACITY, std::memory_order_release);
+        log->tail++;
+    }
+
+    uint32_t dropped = log->dropped.exchange(0, std::memory_order_relaxed);
+    if(dropped > 0)
+    {
+        std::cerr << "validation layer: " << dropped << " messages dropped, the debug log is full" << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+
+// Validation layers and the debug messenger
+// Only builds with VK_DEBUG_LAYERS (the REN_DEBUG_LAYERS CMake option, off for Release builds) know about either, without
+// it vk_init creates a bare instance / device and everything below compiles to nothing.
+// The messenger callback runs on whichever thread made the Vulkan call, so it never touches iostreams. Messages are
+// filtered by severity / type, rate limited per message id and copied into a fixed size multi producer ring that the
+// main thread drains with vk_debug_log_flush. A full ring drops messages and counts them instead of blocking the caller.
+
+#define VK_DEBUG_LOG_CAPACITY 256           // Messages buffered between flushes, power of two
+#define VK_DEBUG_LOG_MESSAGE_SIZE 1024      // Longer messages are truncated
+#define VK_DEBUG_REPEAT_SLOTS 1024          // Distinct message ids the rate limiter tracks, power of two
+#define VK_DEBUG_DEFAULT_REPEAT_LIMIT 8
+
+// Set vk_context::debug before vk_init, ignored without VK_DEBUG_LAYERS
+struct vk_debug_config
+{
+    uint8_t validation = 1;     // 0 runs a debug build without layers / messenger
+    VkDebugUtilsMessageSeverityFlagsEXT severities = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    VkDebugUtilsMessageTypeFlagsEXT types = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    uint32_t repeat_limit = VK_DEBUG_DEFAULT_REPEAT_LIMIT;  // Occurrences of a message id logged in full, after that only every power of two
+};
+
+struct vk_debug_message
+{
+    std::atomic<uint64_t> sequence;     // Ring position the slot is ready to be written (== pos) or read (== pos + 1) at
+    VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+    uint32_t occurrence;                // How often the message id was seen when this one was logged
+    char text[VK_DEBUG_LOG_MESSAGE_SIZE];
+};
+
+struct vk_debug_log
+{
+    vk_debug_config config;
+    vk_debug_message messages[VK_DEBUG_LOG_CAPACITY];
+    std::atomic<uint64_t> head;         // Next position producers claim
+    uint64_t tail;                      // Next position vk_debug_log_flush reads, main thread only
+    std::atomic<uint64_t> repeat_keys[VK_DEBUG_REPEAT_SLOTS];   // Message id | 1 << 32, 0 for a free slot
+    std::atomic<uint32_t> repeat_counts[VK_DEBUG_REPEAT_SLOTS];
+    std::atomic<uint32_t> dropped;      // Messages lost to a full ring since the last flush
+};
+
+#ifdef VK_DEBUG_LAYERS
+
+// Returns NULL on allocation failure, free with vk_debug_log_destroy
+vk_debug_log* vk_debug_log_create(const vk_debug_config& config);
+void vk_debug_log_destroy(vk_debug_log* log);
+
+// Fills in the messenger's severities / types / callback, log is the callback's user data
+void vk_debug_log_messenger_info(vk_debug_log* log, VkDebugUtilsMessengerCreateInfoEXT* info);
+
+// Writes the buffered messages to std::cerr, single consumer: only ever call it from one thread (once a frame and
+// before the instance is destroyed), log may be NULL
+void vk_debug_log_flush(vk_debug_log* log);
+
+#else
+
+inline void vk_debug_log_flush(vk_debug_log* log) {}
+
+#endif
@@ -0,0 +1,19 @@
+#include "vk_embedded_shaders.h"
+#include <algorithm>
+#include <cstring>
+
+int vk_embedded_shader_find(const std::string& name, const uint32_t** code, size_t* size)
+{
+    size_t slash = name.find_last_of("/\\");
+    std::string file_name = slash == std::string::npos ? name : name.substr(slash + 1);
+
+    const vk_embedded_shader* begin = vk_embedded_shaders;
+    const vk_embedded_shader* end = vk_embedded_shaders + vk_embedded_shader_count;
+    const vk_embedded_shader* shader = std::lower_bound(begin, end, file_name, [](const vk_embedded_shader& s, const std::string& n) { return strcmp(s.name, n.c_str()) < 0; });
+
+    if(shader == end || file_name != shader->name) return -1;
+
+    *code = shader->code;
+    *size = shader->size;
+    return 0;
+}
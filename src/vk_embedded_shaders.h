@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// SPIR-V compiled from shaders/ at build time and linked into the binary
+// The table itself is generated by CMakeLists.txt (vk_embedded_shader_table.cpp in the build directory), one entry per
+// shader source named after its file (e.g. "default.vert"), sorted by name.
+
+struct vk_embedded_shader
+{
+    const char* name;
+    const uint32_t* code;
+    size_t size;        // In bytes
+};
+
+extern const vk_embedded_shader vk_embedded_shaders[];
+extern const uint32_t vk_embedded_shader_count;
+
+// Looks up a shader by source file name, leading directories are ignored so "shaders/default.vert" works too
+// 0 - found
+// -1 - no shader with that name was built into the binary
+int vk_embedded_shader_find(const std::string& name, const uint32_t** code, size_t* size);
@@ -0,0 +1,138 @@
+#include "vk_frame.h"
+#include "vklib.h"
+#include "vk_cpu_profiler.h"
+#include <iostream>
+#include <chrono>
+
+int vk_frame_scheduler_create(vk_context& context, uint32_t frames_in_flight, vk_frame_scheduler* scheduler)
+{
+    if(scheduler == NULL || frames_in_flight == 0) return -1;
+
+    scheduler->frames_in_flight = frames_in_flight;
+    scheduler->submitted = 0;
+    scheduler->completed = 0;
+    scheduler->wait_ns = 0;
+
+    VkSemaphoreTypeCreateInfo type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo timeline_info{};
+    timeline_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timeline_info.pNext = &type_info;
+
+    if(vkCreateSemaphore(context.logical_device, &timeline_info, NULL, &scheduler->timeline) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create frame timeline semaphore" << std::endl;
+        return -1;
+    }
+
+    // Headless contexts never acquire or present
+    if(context.headless) return 0;
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    scheduler->image_available.resize(frames_in_flight);
+    scheduler->render_finished.resize(frames_in_flight);
+    for(uint32_t i = 0; i < frames_in_flight; i++)
+    {
+        if(vkCreateSemaphore(context.logical_device, &semaphore_info, NULL, &scheduler->image_available[i]) != VK_SUCCESS ||
+        vkCreateSemaphore(context.logical_device, &semaphore_info, NULL, &scheduler->render_finished[i]) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to create synchronization objects" << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void vk_frame_scheduler_destroy(vk_context& context, vk_frame_scheduler& scheduler)
+{
+    VkSemaphoreWaitInfo wait_info{};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &scheduler.timeline;
+    wait_info.pValues = &scheduler.submitted;
+    vkWaitSemaphores(context.logical_device, &wait_info, UINT64_MAX);
+
+    for(size_t i = 0; i < scheduler.image_available.size(); i++)
+    {
+        vkDestroySemaphore(context.logical_device, scheduler.image_available[i], NULL);
+        vkDestroySemaphore(context.logical_device, scheduler.render_finished[i], NULL);
+    }
+    vkDestroySemaphore(context.logical_device, scheduler.timeline, NULL);
+
+    scheduler.image_available.clear();
+    scheduler.render_finished.clear();
+}
+
+uint32_t vk_frame_begin(vk_context& context, vk_frame_scheduler& scheduler)
+{
+    VK_CPU_ZONE("vk_frame_begin");
+
+    uint64_t value = vk_frame_value(scheduler);
+    scheduler.wait_ns = 0;
+
+    // The slot's previous frame is value - frames_in_flight, skip the driver call entirely if we already know it's done
+    if(value > scheduler.frames_in_flight && scheduler.completed < value - scheduler.frames_in_flight)
+    {
+        uint64_t wait_value = value - scheduler.frames_in_flight;
+
+        VkSemaphoreWaitInfo wait_info{};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &scheduler.timeline;
+        wait_info.pValues = &wait_value;
+
+        auto wait_start = std::chrono::steady_clock::now();
+        vkWaitSemaphores(context.logical_device, &wait_info, UINT64_MAX);
+        scheduler.wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wait_start).count();
+
+        scheduler.completed = wait_value;
+    }
+
+    return value % scheduler.frames_in_flight;
+}
+
+uint64_t vk_frame_value(const vk_frame_scheduler& scheduler)
+{
+    return scheduler.submitted + 1;
+}
+
+VkSemaphoreSubmitInfo vk_frame_signal_info(const vk_frame_scheduler& scheduler)
+{
+    VkSemaphoreSubmitInfo signal_info{};
+    signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal_info.semaphore = scheduler.timeline;
+    signal_info.value = vk_frame_value(scheduler);
+    signal_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    return signal_info;
+}
+
+void vk_frame_submitted(vk_frame_scheduler& scheduler)
+{
+    scheduler.submitted++;
+}
+
+VkSemaphoreSubmitInfo vk_frame_wait_info(const vk_frame_scheduler& scheduler, uint64_t value, VkPipelineStageFlags2 stages)
+{
+    VkSemaphoreSubmitInfo wait_info{};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    wait_info.semaphore = scheduler.timeline;
+    wait_info.value = value;
+    wait_info.stageMask = stages;
+    return wait_info;
+}
+
+uint64_t vk_frame_poll(vk_context& context, vk_frame_scheduler& scheduler)
+{
+    uint64_t value = 0;
+    if(vkGetSemaphoreCounterValue(context.logical_device, scheduler.timeline, &value) == VK_SUCCESS && value > scheduler.completed)
+    {
+        scheduler.completed = value;
+    }
+    return scheduler.completed;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+struct vk_context;
+
+// Frame pacing on a single timeline semaphore
+// Every graphics submission signals the timeline with its frame value (1, 2, 3, ...), so "frame N is done" is the
+// counter having reached N. Starting frame N only waits for frame N - frames_in_flight, there are no fences to reset,
+// and the same value doubles as the serial the staging ring, swapchain retirement and other queues key off of.
+// Acquire / present still need binary semaphores, those are kept per frame slot.
+
+struct vk_frame_scheduler
+{
+    uint32_t frames_in_flight;
+    VkSemaphore timeline;
+    uint64_t submitted;     // Value of the last frame submitted
+    uint64_t completed;     // Value the timeline was last seen at, every frame <= this has finished on the GPU
+    uint64_t wait_ns;       // Time the last vk_frame_begin blocked on the timeline, 0 when the slot was already free
+    std::vector<VkSemaphore> image_available;
+    std::vector<VkSemaphore> render_finished;
+};
+
+int vk_frame_scheduler_create(vk_context& context, uint32_t frames_in_flight, vk_frame_scheduler* scheduler);
+
+// Waits for every submitted frame before destroying the semaphores
+void vk_frame_scheduler_destroy(vk_context& context, vk_frame_scheduler& scheduler);
+
+// Blocks until the previous user of the next frame's slot has finished and returns that slot
+// Calling it again without vk_frame_submitted in between (e.g. after a failed acquire) returns the same slot
+uint32_t vk_frame_begin(vk_context& context, vk_frame_scheduler& scheduler);
+
+// Value the frame being recorded will signal
+uint64_t vk_frame_value(const vk_frame_scheduler& scheduler);
+
+// Signal info to put in the frame's graphics submission, then call vk_frame_submitted once it was submitted
+VkSemaphoreSubmitInfo vk_frame_signal_info(const vk_frame_scheduler& scheduler);
+void vk_frame_submitted(vk_frame_scheduler& scheduler);
+
+// Wait info for work on any queue that must not run stages before frame value has finished
+VkSemaphoreSubmitInfo vk_frame_wait_info(const vk_frame_scheduler& scheduler, uint64_t value, VkPipelineStageFlags2 stages);
+
+// Refreshes scheduler.completed without blocking and returns it
+uint64_t vk_frame_poll(vk_context& context, vk_frame_scheduler& scheduler);
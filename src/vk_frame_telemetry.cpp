@@ -0,0 +1,257 @@
+#include "vk_frame_telemetry.h"
+#include "vklib.h"
+#include <iostream>
+
+const char* const vk_frame_metric_names[VK_FRAME_METRIC_COUNT] =
+{
+    "acquire_wait",
+    "frame_wait",
+    "record",
+    "present_latency",
+    "present_interval"
+};
+
+#define HISTOGRAM_EXACT (1 << VK_HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_HALF (1 << (VK_HISTOGRAM_SUB_BITS - 1))
+
+static uint32_t highest_bit(uint64_t value)
+{
+    uint32_t bit = 0;
+    while(value >>= 1) bit++;
+    return bit;
+}
+
+// Below HISTOGRAM_EXACT every microsecond has its own bucket, above it each power of two is split into HISTOGRAM_HALF
+// buckets by the value's top VK_HISTOGRAM_SUB_BITS bits
+static uint32_t bucket_index(uint64_t value)
+{
+    if(value < HISTOGRAM_EXACT) return (uint32_t)value;
+
+    uint32_t shift = highest_bit(value) - (VK_HISTOGRAM_SUB_BITS - 1);
+    if(shift > VK_HISTOGRAM_MAX_SHIFT) return VK_HISTOGRAM_BUCKETS - 1;
+
+    uint32_t sub = (uint32_t)(value >> shift);
+    return HISTOGRAM_EXACT + (shift - 1) * HISTOGRAM_HALF + (sub - HISTOGRAM_HALF);
+}
+
+// Largest value landing in the bucket
+static uint64_t bucket_upper(uint32_t index)
+{
+    if(index < HISTOGRAM_EXACT) return index;
+
+    uint32_t shift = (index - HISTOGRAM_EXACT) / HISTOGRAM_HALF + 1;
+    uint64_t sub = (index - HISTOGRAM_EXACT) % HISTOGRAM_HALF + HISTOGRAM_HALF;
+    return ((sub + 1) << shift) - 1;
+}
+
+void vk_histogram_reset(vk_histogram& histogram)
+{
+    histogram.counts.assign(VK_HISTOGRAM_BUCKETS, 0);
+    histogram.total = 0;
+    histogram.max_us = 0;
+}
+
+void vk_histogram_record(vk_histogram& histogram, uint64_t value_us)
+{
+    histogram.counts[bucket_index(value_us)]++;
+    histogram.total++;
+    if(value_us > histogram.max_us) histogram.max_us = value_us;
+}
+
+uint64_t vk_histogram_percentile(const vk_histogram& histogram, double fraction)
+{
+    if(histogram.total == 0) return 0;
+
+    uint64_t rank = (uint64_t)(fraction * histogram.total + 0.5);
+    if(rank < 1) rank = 1;
+    if(rank > histogram.total) rank = histogram.total;
+
+    uint64_t seen = 0;
+    for(uint32_t i = 0; i < VK_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram.counts[i];
+        if(seen >= rank)
+        {
+            // The bucket's bound can overshoot the largest value actually recorded
+            uint64_t upper = bucket_upper(i);
+            return upper < histogram.max_us ? upper : histogram.max_us;
+        }
+    }
+
+    return histogram.max_us;
+}
+
+uint64_t vk_histogram_count_above(const vk_histogram& histogram, uint64_t threshold_us)
+{
+    // Buckets straddling the threshold count as below it, off by at most a bucket's width
+    uint64_t count = 0;
+    for(uint32_t i = bucket_index(threshold_us) + 1; i < VK_HISTOGRAM_BUCKETS; i++)
+    {
+        count += histogram.counts[i];
+    }
+
+    return count;
+}
+
+static uint64_t hitch_count(const vk_histogram& intervals)
+{
+    if(intervals.total == 0) return 0;
+    return vk_histogram_count_above(intervals, (uint64_t)(vk_histogram_percentile(intervals, 0.5) * VK_TELEMETRY_HITCH_FACTOR));
+}
+
+static void write_report(vk_frame_telemetry& telemetry, const vk_histogram* histograms, const char* scope, double seconds, uint64_t frames, uint64_t hitches)
+{
+    std::ostream& out = *telemetry.output;
+
+    out << "{\"scope\": \"" << scope << "\", \"seconds\": " << seconds << ", \"frames\": " << frames << ", \"hitches\": " << hitches;
+    for(uint32_t i = 0; i < VK_FRAME_METRIC_COUNT; i++)
+    {
+        const vk_histogram& histogram = histograms[i];
+        if(histogram.total == 0) continue;
+
+        out << ", \"" << vk_frame_metric_names[i] << "_ms\": {\"p50\": " << vk_histogram_percentile(histogram, 0.5) / 1000.0
+            << ", \"p99\": " << vk_histogram_percentile(histogram, 0.99) / 1000.0
+            << ", \"p999\": " << vk_histogram_percentile(histogram, 0.999) / 1000.0
+            << ", \"max\": " << histogram.max_us / 1000.0 << "}";
+    }
+    out << "}" << std::endl;
+}
+
+int vk_frame_telemetry_create(const char* path, double report_interval, vk_frame_telemetry* telemetry)
+{
+    telemetry->output = &std::cout;
+    if(path != NULL)
+    {
+        telemetry->file.open(path, std::ios::trunc);
+        if(!telemetry->file.is_open())
+        {
+            std::cerr << "Failed to open telemetry file " << path << std::endl;
+            return -1;
+        }
+        telemetry->output = &telemetry->file;
+    }
+
+    telemetry->report_interval = report_interval;
+    for(uint32_t i = 0; i < VK_FRAME_METRIC_COUNT; i++)
+    {
+        vk_histogram_reset(telemetry->window[i]);
+        vk_histogram_reset(telemetry->run[i]);
+    }
+    telemetry->window_frames = 0;
+    telemetry->run_frames = 0;
+    telemetry->run_hitches = 0;
+    telemetry->start = std::chrono::steady_clock::now();
+    telemetry->window_start = telemetry->start;
+    telemetry->has_last_present = 0;
+    telemetry->pending.clear();
+    telemetry->pending.reserve(VK_TELEMETRY_MAX_PENDING_PRESENTS);
+
+    return 0;
+}
+
+void vk_frame_telemetry_destroy(vk_frame_telemetry& telemetry)
+{
+    if(telemetry.output == NULL) return;
+
+    // Hitches are judged against each window's own p50 so the run's count is the windows' sum, plus the unreported tail
+    uint64_t hitches = telemetry.run_hitches + hitch_count(telemetry.window[VK_FRAME_METRIC_PRESENT_INTERVAL]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - telemetry.start).count();
+    write_report(telemetry, telemetry.run, "run", seconds, telemetry.run_frames, hitches);
+
+    if(telemetry.file.is_open())
+    {
+        telemetry.file.close();
+    }
+    telemetry.output = NULL;
+    telemetry.pending.clear();
+}
+
+void vk_frame_telemetry_record(vk_frame_telemetry& telemetry, vk_frame_metric metric, std::chrono::steady_clock::duration value)
+{
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(value).count();
+    if(us < 0) us = 0;
+
+    vk_histogram_record(telemetry.window[metric], (uint64_t)us);
+    vk_histogram_record(telemetry.run[metric], (uint64_t)us);
+}
+
+void vk_frame_telemetry_presented(vk_frame_telemetry& telemetry, std::chrono::steady_clock::time_point time)
+{
+    if(telemetry.has_last_present)
+    {
+        vk_frame_telemetry_record(telemetry, VK_FRAME_METRIC_PRESENT_INTERVAL, time - telemetry.last_present);
+    }
+    telemetry.last_present = time;
+    telemetry.has_last_present = 1;
+}
+
+void vk_frame_telemetry_queue_present(vk_context& context, vk_frame_telemetry& telemetry, std::chrono::steady_clock::time_point submit_time)
+{
+    if(!context.present_wait)
+    {
+        vk_frame_telemetry_presented(telemetry, std::chrono::steady_clock::now());
+        return;
+    }
+
+    // Presents that never complete (e.g. the window is minimized) would otherwise pile up, the oldest is dropped
+    if(telemetry.pending.size() >= VK_TELEMETRY_MAX_PENDING_PRESENTS)
+    {
+        telemetry.pending.erase(telemetry.pending.begin());
+    }
+
+    vk_pending_present present;
+    present.swapchain = context.swapchain.swapchain;
+    present.present_id = context.swapchain.present_id;
+    present.submit_time = submit_time;
+    telemetry.pending.push_back(present);
+}
+
+void vk_frame_telemetry_poll(vk_context& context, vk_frame_telemetry& telemetry)
+{
+    // Presents complete in order, stop at the first one that isn't on screen yet
+    size_t done = 0;
+    uint8_t presented = 0;
+    for(; done < telemetry.pending.size(); done++)
+    {
+        const vk_pending_present& present = telemetry.pending[done];
+
+        // The swapchain was recreated since, its ids start over and the old one can't be waited on
+        if(present.swapchain != context.swapchain.swapchain) continue;
+
+        int result = vk_swapchain_poll_present(&context, present.present_id);
+        if(result == 0) break;
+        if(result < 0) continue;
+
+        vk_frame_telemetry_record(telemetry, VK_FRAME_METRIC_PRESENT_LATENCY, std::chrono::steady_clock::now() - present.submit_time);
+        presented = 1;
+    }
+
+    // Several presents seen by the same poll share one completion time, only the newest counts towards the interval
+    if(presented)
+    {
+        vk_frame_telemetry_presented(telemetry, std::chrono::steady_clock::now());
+    }
+
+    telemetry.pending.erase(telemetry.pending.begin(), telemetry.pending.begin() + done);
+}
+
+void vk_frame_telemetry_end_frame(vk_frame_telemetry& telemetry)
+{
+    telemetry.window_frames++;
+    telemetry.run_frames++;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - telemetry.window_start).count();
+    if(seconds < telemetry.report_interval) return;
+
+    uint64_t hitches = hitch_count(telemetry.window[VK_FRAME_METRIC_PRESENT_INTERVAL]);
+    write_report(telemetry, telemetry.window, "window", seconds, telemetry.window_frames, hitches);
+    telemetry.run_hitches += hitches;
+
+    for(uint32_t i = 0; i < VK_FRAME_METRIC_COUNT; i++)
+    {
+        vk_histogram_reset(telemetry.window[i]);
+    }
+    telemetry.window_frames = 0;
+    telemetry.window_start = now;
+}
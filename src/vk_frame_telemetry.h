@@ -0,0 +1,102 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <chrono>
+#include <fstream>
+
+struct vk_context;
+
+// Frame pacing telemetry
+// Every frame feeds the time it spent in the synchronization points of the frame loop into log-linear (HDR style)
+// histograms: 2^VK_HISTOGRAM_SUB_BITS exact microsecond buckets, then 2^(VK_HISTOGRAM_SUB_BITS - 1) buckets per power
+// of two, so any recorded value is within ~1.6% of its bucket. Every report_interval seconds the window's p50 / p99 /
+// p99.9 / max of each metric and its hitch count (present intervals over twice the window's p50) are written as one
+// JSON object per line, to stdout or a file, and the window starts over. Destroying the telemetry writes one more line
+// covering the whole run.
+// Present timing comes from present ids: with present wait (see vk_swapchain_poll_present) a present counts as done
+// when vk_frame_telemetry_poll sees it on screen, which the frame loop does once a frame, so outside the low latency
+// policy (which blocks on it) it reads late by up to a frame. Without present wait only the interval between present
+// calls is known.
+
+#define VK_HISTOGRAM_SUB_BITS 7
+#define VK_HISTOGRAM_MAX_SHIFT 26           // Values up to 2^(26 + 7) us (~2.4 hours), larger ones land in the last bucket
+#define VK_HISTOGRAM_BUCKETS ((1 << VK_HISTOGRAM_SUB_BITS) + VK_HISTOGRAM_MAX_SHIFT * (1 << (VK_HISTOGRAM_SUB_BITS - 1)))
+
+#define VK_TELEMETRY_HITCH_FACTOR 2.0
+#define VK_TELEMETRY_MAX_PENDING_PRESENTS 16
+
+enum vk_frame_metric
+{
+    VK_FRAME_METRIC_ACQUIRE_WAIT = 0,       // vkAcquireNextImageKHR
+    VK_FRAME_METRIC_FRAME_WAIT = 1,         // vk_frame_begin blocked on the frame timeline (the frame fence)
+    VK_FRAME_METRIC_RECORD = 2,             // Frame command buffer begin to end, secondaries included
+    VK_FRAME_METRIC_PRESENT_LATENCY = 3,    // Submit to the frame on screen, present wait only
+    VK_FRAME_METRIC_PRESENT_INTERVAL = 4,   // Between consecutive presents on screen (present calls without present wait, submits when headless)
+    VK_FRAME_METRIC_COUNT = 5
+};
+
+extern const char* const vk_frame_metric_names[VK_FRAME_METRIC_COUNT];
+
+struct vk_histogram
+{
+    std::vector<uint64_t> counts;   // VK_HISTOGRAM_BUCKETS
+    uint64_t total;
+    uint64_t max_us;
+};
+
+// Submitted frame waiting for its present to show up on screen
+struct vk_pending_present
+{
+    VkSwapchainKHR swapchain;
+    uint64_t present_id;
+    std::chrono::steady_clock::time_point submit_time;
+};
+
+struct vk_frame_telemetry
+{
+    std::ofstream file;
+    std::ostream* output;           // std::cout or file
+    double report_interval;         // Seconds
+    vk_histogram window[VK_FRAME_METRIC_COUNT];
+    vk_histogram run[VK_FRAME_METRIC_COUNT];
+    uint64_t window_frames;
+    uint64_t run_frames;
+    uint64_t run_hitches;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point window_start;
+    std::chrono::steady_clock::time_point last_present;
+    uint8_t has_last_present;
+    std::vector<vk_pending_present> pending;
+};
+
+void vk_histogram_reset(vk_histogram& histogram);
+void vk_histogram_record(vk_histogram& histogram, uint64_t value_us);
+
+// Value (us) at or below which fraction (0..1) of the recorded values are, 0 for an empty histogram
+uint64_t vk_histogram_percentile(const vk_histogram& histogram, double fraction);
+
+// Number of recorded values above threshold_us
+uint64_t vk_histogram_count_above(const vk_histogram& histogram, uint64_t threshold_us);
+
+// path NULL reports to stdout
+// 0 - success
+// -1 - failure
+int vk_frame_telemetry_create(const char* path, double report_interval, vk_frame_telemetry* telemetry);
+
+// Writes the whole run's report and closes the file
+void vk_frame_telemetry_destroy(vk_frame_telemetry& telemetry);
+
+void vk_frame_telemetry_record(vk_frame_telemetry& telemetry, vk_frame_metric metric, std::chrono::steady_clock::duration value);
+
+// A frame was presented at time (present call without present wait, submit when headless), records the interval
+void vk_frame_telemetry_presented(vk_frame_telemetry& telemetry, std::chrono::steady_clock::time_point time);
+
+// Call after every successful vk_swapchain_present with the frame's submit time, the present is timed by
+// vk_frame_telemetry_poll if the context has present wait and counted as presented right away otherwise
+void vk_frame_telemetry_queue_present(vk_context& context, vk_frame_telemetry& telemetry, std::chrono::steady_clock::time_point submit_time);
+
+// Checks which queued presents reached the screen, once a frame from the thread presenting
+void vk_frame_telemetry_poll(vk_context& context, vk_frame_telemetry& telemetry);
+
+// Counts the frame and writes a report when the interval is up
+void vk_frame_telemetry_end_frame(vk_frame_telemetry& telemetry);
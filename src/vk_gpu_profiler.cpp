@@ -0,0 +1,278 @@
+#include "vk_gpu_profiler.h"
+#include "vklib.h"
+#include <iostream>
+#include <algorithm>
+
+const char* const vk_gpu_profiler_statistic_names[VK_GPU_PROFILER_STATISTIC_COUNT] =
+{
+    "primitives",
+    "vertex_invocations",
+    "clipped_primitives",
+    "fragment_invocations",
+    "compute_invocations"
+};
+
+int vk_gpu_profiler_create(vk_context& context, uint32_t frame_count, uint8_t pipeline_statistics, vk_gpu_profiler* profiler)
+{
+    if(profiler == NULL || frame_count == 0) return -1;
+
+    profiler->current = 0;
+    profiler->enabled = 0;
+    profiler->pipeline_statistics = 0;
+    profiler->frame_ms = 0.0;
+    profiler->trace = NULL;
+    profiler->trace_offset_us = 0.0;
+    profiler->trace_anchored = 0;
+
+    queue_families queues = vk_get_device_queues(context.physical_device, context);
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(context.physical_device, &family_count, NULL);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(context.physical_device, &family_count, families.data());
+
+    uint32_t valid_bits = queues.graphics < family_count ? families[queues.graphics].timestampValidBits : 0;
+    if(valid_bits == 0)
+    {
+        std::cerr << "Graphics queue has no timestamp support, GPU profiling is disabled" << std::endl;
+        return 0;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+    profiler->timestamp_period = properties.limits.timestampPeriod;
+    profiler->timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+
+    if(pipeline_statistics && !context.pipeline_statistics)
+    {
+        std::cerr << "Device has no pipeline statistics queries, GPU profiling only collects timings" << std::endl;
+    }
+    profiler->pipeline_statistics = pipeline_statistics && context.pipeline_statistics;
+
+    profiler->frames.resize(frame_count);
+    for(vk_gpu_profiler_frame& frame : profiler->frames)
+    {
+        frame.timestamps = VK_NULL_HANDLE;
+        frame.statistics = VK_NULL_HANDLE;
+        frame.statistics_count = 0;
+        frame.cpu_begin_us = 0.0;
+        frame.pending = 0;
+    }
+
+    for(vk_gpu_profiler_frame& frame : profiler->frames)
+    {
+        VkQueryPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        pool_info.queryCount = VK_GPU_PROFILER_MAX_REGIONS * 2;
+
+        if(vkCreateQueryPool(context.logical_device, &pool_info, NULL, &frame.timestamps) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to create timestamp query pool" << std::endl;
+            vk_gpu_profiler_destroy(context, *profiler);
+            return -1;
+        }
+
+        if(profiler->pipeline_statistics)
+        {
+            pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            pool_info.queryCount = VK_GPU_PROFILER_MAX_REGIONS;
+            pool_info.pipelineStatistics = VK_GPU_PROFILER_STATISTICS;
+
+            if(vkCreateQueryPool(context.logical_device, &pool_info, NULL, &frame.statistics) != VK_SUCCESS)
+            {
+                std::cerr << "Failed to create pipeline statistics query pool" << std::endl;
+                vk_gpu_profiler_destroy(context, *profiler);
+                return -1;
+            }
+        }
+    }
+
+    profiler->enabled = 1;
+
+    return 0;
+}
+
+void vk_gpu_profiler_destroy(vk_context& context, vk_gpu_profiler& profiler)
+{
+    for(vk_gpu_profiler_frame& frame : profiler.frames)
+    {
+        if(frame.timestamps != VK_NULL_HANDLE) vkDestroyQueryPool(context.logical_device, frame.timestamps, NULL);
+        if(frame.statistics != VK_NULL_HANDLE) vkDestroyQueryPool(context.logical_device, frame.statistics, NULL);
+    }
+
+    profiler.frames.clear();
+    profiler.enabled = 0;
+}
+
+static void read_back(vk_context& context, vk_gpu_profiler& profiler, vk_gpu_profiler_frame& frame)
+{
+    frame.pending = 0;
+    uint32_t region_count = frame.regions.size();
+    if(region_count == 0) return;
+
+    // Value / availability pairs, VK_NOT_READY only means some availability words are 0
+    std::vector<uint64_t> timestamps((size_t)region_count * 4);
+    vkGetQueryPoolResults(context.logical_device, frame.timestamps, 0, region_count * 2, timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                          2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    const uint32_t statistics_stride = VK_GPU_PROFILER_STATISTIC_COUNT + 1;
+    std::vector<uint64_t> statistics((size_t)frame.statistics_count * statistics_stride);
+    if(frame.statistics_count > 0)
+    {
+        vkGetQueryPoolResults(context.logical_device, frame.statistics, 0, frame.statistics_count, statistics.size() * sizeof(uint64_t), statistics.data(),
+                              statistics_stride * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    }
+
+    std::vector<vk_gpu_region_result> results;
+    uint64_t first = 0;
+    double frame_ms = 0.0;
+    double ms_per_tick = profiler.timestamp_period / 1000000.0;
+
+    for(uint32_t i = 0; i < region_count; i++)
+    {
+        const uint64_t* pair = &timestamps[(size_t)i * 4];
+        if(pair[1] == 0 || pair[3] == 0) continue;
+
+        // Regions are numbered in begin order so the first available one started the frame
+        if(results.empty()) first = pair[0];
+
+        const vk_gpu_region& region = frame.regions[i];
+        vk_gpu_region_result result{};
+        result.name = region.name;
+        result.depth = region.depth;
+        result.start_ms = ((pair[0] - first) & profiler.timestamp_mask) * ms_per_tick;
+        result.duration_ms = ((pair[2] - pair[0]) & profiler.timestamp_mask) * ms_per_tick;
+
+        if(region.statistics != VK_GPU_PROFILER_NONE)
+        {
+            const uint64_t* counters = &statistics[(size_t)region.statistics * statistics_stride];
+            result.has_statistics = counters[VK_GPU_PROFILER_STATISTIC_COUNT] != 0;
+            for(uint32_t j = 0; j < VK_GPU_PROFILER_STATISTIC_COUNT && result.has_statistics; j++)
+            {
+                result.statistics[j] = counters[j];
+            }
+        }
+
+        frame_ms = std::max(frame_ms, result.start_ms + result.duration_ms);
+        results.push_back(result);
+    }
+
+    if(results.empty()) return;
+
+    profiler.results.swap(results);
+    profiler.frame_ms = frame_ms;
+
+    if(profiler.trace == NULL) return;
+
+    // The offset only ever grows: the GPU can't start a frame before the CPU began recording it, so the largest
+    // (CPU begin - GPU start) seen so far is the tightest lower bound on the real offset
+    double first_us = (double)first * profiler.timestamp_period / 1000.0;
+    double offset_us = frame.cpu_begin_us - first_us;
+    if(!profiler.trace_anchored || offset_us > profiler.trace_offset_us)
+    {
+        profiler.trace_offset_us = offset_us;
+        profiler.trace_anchored = 1;
+    }
+
+    for(const vk_gpu_region_result& result : profiler.results)
+    {
+        std::string args;
+        if(result.has_statistics)
+        {
+            for(uint32_t j = 0; j < VK_GPU_PROFILER_STATISTIC_COUNT; j++)
+            {
+                if(j > 0) args += ", ";
+                args += "\"" + std::string(vk_gpu_profiler_statistic_names[j]) + "\": " + std::to_string(result.statistics[j]);
+            }
+        }
+
+        vk_trace_add(*profiler.trace, result.name, "gpu", VK_TRACE_PID_GPU, 0, first_us + profiler.trace_offset_us + result.start_ms * 1000.0,
+                     result.duration_ms * 1000.0, args);
+    }
+}
+
+void vk_gpu_profiler_begin_frame(vk_context& context, vk_gpu_profiler& profiler, VkCommandBuffer cmd, uint32_t frame)
+{
+    if(!profiler.enabled) return;
+
+    profiler.current = frame % profiler.frames.size();
+    vk_gpu_profiler_frame& current = profiler.frames[profiler.current];
+
+    if(current.pending)
+    {
+        read_back(context, profiler, current);
+    }
+
+    current.regions.clear();
+    current.statistics_count = 0;
+    current.cpu_begin_us = vk_trace_now_us();
+    current.pending = 1;
+    profiler.open.clear();
+
+    vkCmdResetQueryPool(cmd, current.timestamps, 0, VK_GPU_PROFILER_MAX_REGIONS * 2);
+    if(current.statistics != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(cmd, current.statistics, 0, VK_GPU_PROFILER_MAX_REGIONS);
+    }
+}
+
+void vk_gpu_profiler_read_pending(vk_context& context, vk_gpu_profiler& profiler)
+{
+    if(!profiler.enabled) return;
+
+    uint32_t frame_count = profiler.frames.size();
+    for(uint32_t i = 1; i <= frame_count; i++)
+    {
+        vk_gpu_profiler_frame& frame = profiler.frames[(profiler.current + i) % frame_count];
+        if(frame.pending)
+        {
+            read_back(context, profiler, frame);
+        }
+    }
+}
+
+uint32_t vk_gpu_profiler_begin(vk_gpu_profiler& profiler, VkCommandBuffer cmd, const std::string& name)
+{
+    if(!profiler.enabled) return VK_GPU_PROFILER_NONE;
+
+    vk_gpu_profiler_frame& frame = profiler.frames[profiler.current];
+    if(frame.regions.size() >= VK_GPU_PROFILER_MAX_REGIONS) return VK_GPU_PROFILER_NONE;
+
+    uint32_t index = frame.regions.size();
+
+    vk_gpu_region region;
+    region.name = name;
+    region.depth = profiler.open.size();
+    region.statistics = VK_GPU_PROFILER_NONE;
+
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame.timestamps, index * 2);
+
+    // Only one statistics query may be active at a time, nested regions go without
+    if(profiler.pipeline_statistics && region.depth == 0)
+    {
+        region.statistics = frame.statistics_count++;
+        vkCmdBeginQuery(cmd, frame.statistics, region.statistics, 0);
+    }
+
+    frame.regions.push_back(region);
+    profiler.open.push_back(index);
+
+    return index;
+}
+
+void vk_gpu_profiler_end(vk_gpu_profiler& profiler, VkCommandBuffer cmd, uint32_t region)
+{
+    if(!profiler.enabled || region == VK_GPU_PROFILER_NONE) return;
+
+    vk_gpu_profiler_frame& frame = profiler.frames[profiler.current];
+    if(region >= frame.regions.size()) return;
+
+    if(frame.regions[region].statistics != VK_GPU_PROFILER_NONE)
+    {
+        vkCmdEndQuery(cmd, frame.statistics, frame.regions[region].statistics);
+    }
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame.timestamps, region * 2 + 1);
+
+    auto open = std::find(profiler.open.begin(), profiler.open.end(), region);
+    if(open != profiler.open.end()) profiler.open.erase(open);
+}
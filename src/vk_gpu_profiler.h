@@ -0,0 +1,90 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include "vk_trace.h"
+
+struct vk_context;
+
+// GPU timings
+// Named regions of a frame's command buffer are bracketed with vkCmdWriteTimestamp2 (ALL_COMMANDS, so a region spans
+// from the end of the work recorded before it to the end of its own) into one query pool per frame in flight. Top
+// level regions can also carry a pipeline statistics query, those can't nest. Results are read back when the frame's
+// slot comes around again: vk_frame_begin has waited for it by then, so vkGetQueryPoolResults is polled with
+// WITH_AVAILABILITY instead of WAIT and never stalls, a region that isn't available yet is just dropped.
+// With a trace attached every read back region is also added as a GPU event. Vulkan timestamps have no relation to the
+// CPU clock, the GPU timeline is shifted so no frame starts before the CPU began recording it.
+
+#define VK_GPU_PROFILER_MAX_REGIONS 64
+#define VK_GPU_PROFILER_NONE UINT32_MAX
+
+// Counters collected per region with pipeline statistics, in the order Vulkan writes them (lowest flag bit first)
+#define VK_GPU_PROFILER_STATISTIC_COUNT 5
+#define VK_GPU_PROFILER_STATISTICS (VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | \
+                                    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | \
+                                    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT)
+
+extern const char* const vk_gpu_profiler_statistic_names[VK_GPU_PROFILER_STATISTIC_COUNT];
+
+struct vk_gpu_region
+{
+    std::string name;
+    uint32_t depth;
+    uint32_t statistics;    // Index into the frame's statistics pool, VK_GPU_PROFILER_NONE without
+};
+
+struct vk_gpu_profiler_frame
+{
+    VkQueryPool timestamps;     // Two per region, begin and end
+    VkQueryPool statistics;
+    std::vector<vk_gpu_region> regions;
+    uint32_t statistics_count;
+    double cpu_begin_us;        // vk_trace_now_us when the frame started recording
+    uint8_t pending;            // Recorded, results not read back yet
+};
+
+struct vk_gpu_region_result
+{
+    std::string name;
+    uint32_t depth;
+    double start_ms;            // Relative to the frame's first region
+    double duration_ms;
+    uint8_t has_statistics;
+    uint64_t statistics[VK_GPU_PROFILER_STATISTIC_COUNT];
+};
+
+struct vk_gpu_profiler
+{
+    std::vector<vk_gpu_profiler_frame> frames;
+    uint32_t current;
+    uint8_t enabled;            // The graphics queue supports timestamps
+    uint8_t pipeline_statistics;
+    double timestamp_period;    // Nanoseconds per tick
+    uint64_t timestamp_mask;    // timestampValidBits worth of ones
+    std::vector<uint32_t> open;     // Regions begun but not ended yet, innermost last
+    std::vector<vk_gpu_region_result> results;  // Regions of the latest frame read back
+    double frame_ms;            // First region's start to last region's end of that frame
+    vk_trace* trace;            // Read back regions are added here when set
+    double trace_offset_us;     // GPU time + offset = trace time
+    uint8_t trace_anchored;
+};
+
+// pipeline_statistics is ignored (with a warning) on devices without pipelineStatisticsQuery
+// A queue without timestamp support leaves the profiler disabled, every call is then a no-op
+// 0 - success
+// -1 - failure
+int vk_gpu_profiler_create(vk_context& context, uint32_t frame_count, uint8_t pipeline_statistics, vk_gpu_profiler* profiler);
+void vk_gpu_profiler_destroy(vk_context& context, vk_gpu_profiler& profiler);
+
+// Reads back frame's previous results and resets its queries in cmd, call at the start of the frame's command buffer
+// once vk_frame_begin has returned frame
+void vk_gpu_profiler_begin_frame(vk_context& context, vk_gpu_profiler& profiler, VkCommandBuffer cmd, uint32_t frame);
+
+// Reads back every frame still pending, oldest first. Only once the device is idle, e.g. before writing the trace on exit
+void vk_gpu_profiler_read_pending(vk_context& context, vk_gpu_profiler& profiler);
+
+// Regions nest, end them in reverse order. Returns the region for vk_gpu_profiler_end, VK_GPU_PROFILER_NONE when the
+// frame ran out of regions (ending it is a no-op). Both calls have to be outside of dynamic rendering / render passes
+// or inside the same one
+uint32_t vk_gpu_profiler_begin(vk_gpu_profiler& profiler, VkCommandBuffer cmd, const std::string& name);
+void vk_gpu_profiler_end(vk_gpu_profiler& profiler, VkCommandBuffer cmd, uint32_t region);
@@ -0,0 +1,158 @@
+#include "vk_gpu_scene.h"
+#include <iostream>
+
+// Matches the push constants in shaders/cull.comp
+struct cull_constants
+{
+    float planes[6][4];
+    VkDeviceAddress records;
+    VkDeviceAddress commands;
+    VkDeviceAddress count;
+    uint32_t record_count;
+};
+
+static VkDeviceAddress buffer_address(vk_context& context, VkBuffer buffer)
+{
+    VkBufferDeviceAddressInfo address_info{};
+    address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    address_info.buffer = buffer;
+    return vkGetBufferDeviceAddress(context.logical_device, &address_info);
+}
+
+int vk_gpu_scene_create(vk_context& context, uint32_t capacity, uint32_t frame_count, vk_gpu_scene* scene)
+{
+    if(scene == NULL || capacity == 0 || frame_count == 0) return -1;
+
+    scene->capacity = capacity;
+    scene->record_count = 0;
+    scene->frame_count = frame_count;
+
+    if(vk_buffer_create(context.allocator, (VkDeviceSize)capacity * sizeof(vk_draw_record),
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &scene->records) < 0)
+    {
+        std::cerr << "Failed to create draw record buffer" << std::endl;
+        return -1;
+    }
+
+    // Every frame in flight culls into its own commands / count so the next frame's pass never overwrites draws still being read
+    if(vk_buffer_create(context.allocator, (VkDeviceSize)capacity * frame_count * sizeof(VkDrawIndexedIndirectCommand),
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &scene->commands) < 0)
+    {
+        std::cerr << "Failed to create indirect command buffer" << std::endl;
+        vk_buffer_destroy(context.allocator, scene->records);
+        return -1;
+    }
+
+    if(vk_buffer_create(context.allocator, (VkDeviceSize)frame_count * sizeof(uint32_t),
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &scene->counts) < 0)
+    {
+        std::cerr << "Failed to create indirect count buffer" << std::endl;
+        vk_buffer_destroy(context.allocator, scene->commands);
+        vk_buffer_destroy(context.allocator, scene->records);
+        return -1;
+    }
+
+    scene->records_address = buffer_address(context, scene->records.buffer);
+    scene->commands_address = buffer_address(context, scene->commands.buffer);
+    scene->counts_address = buffer_address(context, scene->counts.buffer);
+
+    if(vk_compute_pipeline_create(context, "cull.comp", VK_NULL_HANDLE, &scene->cull_pipeline) < 0)
+    {
+        vk_buffer_destroy(context.allocator, scene->counts);
+        vk_buffer_destroy(context.allocator, scene->commands);
+        vk_buffer_destroy(context.allocator, scene->records);
+        return -1;
+    }
+
+    return 0;
+}
+
+void vk_gpu_scene_destroy(vk_context& context, vk_gpu_scene& scene)
+{
+    vk_dynamic_pipeline_destroy(context, scene.cull_pipeline);
+    vk_buffer_destroy(context.allocator, scene.counts);
+    vk_buffer_destroy(context.allocator, scene.commands);
+    vk_buffer_destroy(context.allocator, scene.records);
+}
+
+int vk_gpu_scene_add(vk_gpu_scene& scene, vk_staging_ring& ring, const vk_mesh& mesh, const float bounds[4], uint32_t object_index, uint32_t* record)
+{
+    if(scene.record_count >= scene.capacity)
+    {
+        std::cerr << "GPU scene is full" << std::endl;
+        return -1;
+    }
+
+    vk_draw_record draw{};
+    draw.bounds[0] = bounds[0];
+    draw.bounds[1] = bounds[1];
+    draw.bounds[2] = bounds[2];
+    draw.bounds[3] = bounds[3];
+    draw.index_count = mesh.index_count;
+    draw.first_index = mesh.first_index;
+    draw.vertex_offset = mesh.vertex_offset;
+    draw.object_index = object_index;
+
+    if(vk_staging_ring_upload(ring, scene.records.buffer, (VkDeviceSize)scene.record_count * sizeof(vk_draw_record), &draw, sizeof(draw)) < 0)
+    {
+        return -1;
+    }
+
+    if(record != NULL) *record = scene.record_count;
+    scene.record_count++;
+
+    return 0;
+}
+
+void vk_gpu_scene_cull(VkCommandBuffer cmd, vk_gpu_scene& scene, uint32_t frame, const float planes[6][4])
+{
+    frame %= scene.frame_count;
+
+    VkDeviceSize count_offset = (VkDeviceSize)frame * sizeof(uint32_t);
+    vkCmdFillBuffer(cmd, scene.counts.buffer, count_offset, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clear_barrier{};
+    clear_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clear_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clear_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clear_barrier, 0, NULL, 0, NULL);
+
+    if(scene.record_count > 0)
+    {
+        cull_constants constants;
+        for(uint32_t i = 0; i < 6; i++)
+        {
+            constants.planes[i][0] = planes[i][0];
+            constants.planes[i][1] = planes[i][1];
+            constants.planes[i][2] = planes[i][2];
+            constants.planes[i][3] = planes[i][3];
+        }
+        constants.records = scene.records_address;
+        constants.commands = scene.commands_address + (VkDeviceSize)frame * scene.capacity * sizeof(VkDrawIndexedIndirectCommand);
+        constants.count = scene.counts_address + count_offset;
+        constants.record_count = scene.record_count;
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, scene.cull_pipeline.pipeline);
+        vkCmdPushConstants(cmd, scene.cull_pipeline.layout, VK_SHADER_STAGE_ALL, 0, sizeof(constants), &constants);
+        vkCmdDispatch(cmd, (scene.record_count + VK_GPU_SCENE_CULL_GROUP_SIZE - 1) / VK_GPU_SCENE_CULL_GROUP_SIZE, 1, 1);
+    }
+
+    VkMemoryBarrier cull_barrier{};
+    cull_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cull_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cull_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &cull_barrier, 0, NULL, 0, NULL);
+}
+
+void vk_gpu_scene_draw(VkCommandBuffer cmd, vk_gpu_scene& scene, uint32_t frame)
+{
+    frame %= scene.frame_count;
+
+    vkCmdDrawIndexedIndirectCount(cmd, scene.commands.buffer, (VkDeviceSize)frame * scene.capacity * sizeof(VkDrawIndexedIndirectCommand),
+                                  scene.counts.buffer, (VkDeviceSize)frame * sizeof(uint32_t), scene.capacity, sizeof(VkDrawIndexedIndirectCommand));
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "vklib.h"
+#include "vk_staging.h"
+#include "vk_cull.h"
+
+// GPU driven drawing of everything in a mesh pool
+// Every object is a draw record (mesh range + world space bounding sphere) living in a device local storage buffer.
+// Each frame a compute pass (shaders/cull.comp) tests the records against the frustum and appends the survivors to an
+// indirect command buffer with an atomic counter, then one vkCmdDrawIndexedIndirectCount draws them all. The CPU
+// never touches individual draws, its per frame cost doesn't grow with the number of objects.
+// Commands are written with firstInstance = object_index so vertex shaders find their per object data through
+// gl_InstanceIndex.
+
+#define VK_GPU_SCENE_CULL_GROUP_SIZE 64
+
+// Matches draw_record in shaders/cull.comp (std430)
+struct vk_draw_record
+{
+    float bounds[4];        // Sphere center xyz + radius
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t object_index;
+};
+
+struct vk_gpu_scene
+{
+    vk_buffer records;
+    vk_buffer commands;     // capacity VkDrawIndexedIndirectCommands per frame in flight
+    vk_buffer counts;       // One draw count per frame in flight
+    VkDeviceAddress records_address;
+    VkDeviceAddress commands_address;
+    VkDeviceAddress counts_address;
+    uint32_t capacity;
+    uint32_t record_count;
+    uint32_t frame_count;
+    vk_dynamic_pipeline cull_pipeline;     // Uses the bindless heap's shared layout
+};
+
+int vk_gpu_scene_create(vk_context& context, uint32_t capacity, uint32_t frame_count, vk_gpu_scene* scene);
+void vk_gpu_scene_destroy(vk_context& context, vk_gpu_scene& scene);
+
+// Queues the record upload through the staging ring, it takes part in culling once the ring's copies have executed
+// 0 - success
+// -1 - the scene or the staging ring is full
+int vk_gpu_scene_add(vk_gpu_scene& scene, vk_staging_ring& ring, const vk_mesh& mesh, const float bounds[4], uint32_t object_index, uint32_t* record);
+
+// Records the culling pass for frame, must be outside of a render pass / dynamic rendering
+// planes are the frustum planes from vk_frustum_planes
+void vk_gpu_scene_cull(VkCommandBuffer cmd, vk_gpu_scene& scene, uint32_t frame, const float planes[6][4]);
+
+// Draws frame's surviving records, bind the pipeline, the scene's mesh pool and push constants first
+void vk_gpu_scene_draw(VkCommandBuffer cmd, vk_gpu_scene& scene, uint32_t frame);
@@ -0,0 +1,163 @@
+#include "vk_instancing.h"
+#include "vk_cpu_profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+size_t vk_instance_key_hash::operator()(const vk_instance_key& key) const
+{
+    size_t hash = std::hash<const void*>()((const void*)key.pipeline);
+    hash = hash * 31 + std::hash<const void*>()(key.pool);
+    hash = hash * 31 + key.first_index;
+    hash = hash * 31 + key.index_count;
+    hash = hash * 31 + (uint32_t)key.vertex_offset;
+    return hash;
+}
+
+int vk_instance_queue_create(uint32_t instance_stride, vk_instance_queue* queue)
+{
+    if(queue == NULL || instance_stride == 0) return -1;
+
+    queue->instance_stride = instance_stride;
+    queue->batches.clear();
+    queue->lookup.clear();
+    queue->draws.clear();
+    queue->instance_buffer = VK_NULL_HANDLE;
+    queue->instance_offset = 0;
+    queue->instance_count = 0;
+
+    return 0;
+}
+
+void vk_instance_queue_begin(vk_instance_queue& queue)
+{
+    for(vk_instance_batch& batch : queue.batches)
+    {
+        batch.data.clear();
+        batch.instance_count = 0;
+    }
+
+    queue.draws.clear();
+    queue.instance_count = 0;
+}
+
+void vk_instance_queue_add(vk_instance_queue& queue, VkPipeline pipeline, const vk_mesh_pool& pool, const vk_mesh& mesh, const void* instances, uint32_t count)
+{
+    if(count == 0) return;
+
+    vk_instance_key key{};
+    key.pipeline = pipeline;
+    key.pool = &pool;
+    key.first_index = mesh.first_index;
+    key.index_count = mesh.index_count;
+    key.vertex_offset = mesh.vertex_offset;
+
+    uint32_t index;
+    auto found = queue.lookup.find(key);
+    if(found != queue.lookup.end())
+    {
+        index = found->second;
+    }
+    else
+    {
+        index = queue.batches.size();
+        queue.lookup.emplace(key, index);
+
+        vk_instance_batch batch{};
+        batch.key = key;
+        batch.mesh = mesh;
+        queue.batches.push_back(batch);
+    }
+
+    vk_instance_batch& batch = queue.batches[index];
+    const uint8_t* bytes = (const uint8_t*)instances;
+    batch.data.insert(batch.data.end(), bytes, bytes + (size_t)count * queue.instance_stride);
+    batch.instance_count += count;
+    queue.instance_count += count;
+}
+
+int vk_instance_queue_build(vk_instance_queue& queue, vk_uniform_ring& ring)
+{
+    VK_CPU_ZONE("vk_instance_queue_build");
+
+    queue.draws.clear();
+    if(queue.instance_count == 0) return 0;
+
+    vk_uniform_allocation allocation;
+    if(vk_uniform_ring_alloc(ring, queue.instance_count * queue.instance_stride, &allocation) < 0)
+    {
+        return -1;
+    }
+
+    for(uint32_t i = 0; i < queue.batches.size(); i++)
+    {
+        if(queue.batches[i].instance_count > 0) queue.draws.push_back(i);
+    }
+
+    // Draws sharing a pipeline / mesh pool end up next to each other so recording only binds when they change
+    std::sort(queue.draws.begin(), queue.draws.end(), [&](uint32_t a, uint32_t b)
+    {
+        const vk_instance_key& key_a = queue.batches[a].key;
+        const vk_instance_key& key_b = queue.batches[b].key;
+        if(key_a.pipeline != key_b.pipeline) return key_a.pipeline < key_b.pipeline;
+        return key_a.pool < key_b.pool;
+    });
+
+    uint32_t first_instance = 0;
+    for(uint32_t index : queue.draws)
+    {
+        vk_instance_batch& batch = queue.batches[index];
+        memcpy((uint8_t*)allocation.data + (size_t)first_instance * queue.instance_stride, batch.data.data(), batch.data.size());
+        batch.first_instance = first_instance;
+        first_instance += batch.instance_count;
+    }
+
+    queue.instance_buffer = ring.buffer.buffer;
+    queue.instance_offset = allocation.offset;
+
+    return queue.draws.size();
+}
+
+void vk_instance_queue_submit(const vk_instance_queue& queue, vk_render_queue& render_queue, uint8_t pass, VkPipeline pipeline, const void* push, uint32_t push_size)
+{
+    if(queue.draws.empty()) return;
+
+    vk_render_queue_set_instances(render_queue, queue.instance_buffer, queue.instance_offset);
+
+    for(uint32_t index : queue.draws)
+    {
+        const vk_instance_batch& batch = queue.batches[index];
+        VkPipeline draw_pipeline = pipeline != VK_NULL_HANDLE ? pipeline : batch.key.pipeline;
+        uint64_t key = vk_sort_key(pass, vk_render_queue_pipeline_id(render_queue, draw_pipeline), 0, 0.0f);
+        vk_render_queue_submit(render_queue, key, draw_pipeline, *batch.key.pool, batch.mesh, batch.instance_count, batch.first_instance, push, push_size);
+    }
+}
+
+void vk_instance_queue_record(VkCommandBuffer cmd, const vk_instance_queue& queue, uint32_t begin, uint32_t end)
+{
+    if(begin >= end) return;
+
+    vkCmdBindVertexBuffers(cmd, VK_MESH_INSTANCE_BINDING, 1, &queue.instance_buffer, &queue.instance_offset);
+
+    VkPipeline bound_pipeline = VK_NULL_HANDLE;
+    const vk_mesh_pool* bound_pool = NULL;
+
+    for(uint32_t i = begin; i < end; i++)
+    {
+        const vk_instance_batch& batch = queue.batches[queue.draws[i]];
+
+        if(batch.key.pipeline != bound_pipeline)
+        {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.key.pipeline);
+            bound_pipeline = batch.key.pipeline;
+        }
+
+        if(batch.key.pool != bound_pool)
+        {
+            vk_mesh_pool_bind(cmd, *batch.key.pool);
+            bound_pool = batch.key.pool;
+        }
+
+        vk_mesh_draw(cmd, batch.mesh, batch.instance_count, batch.first_instance);
+    }
+}
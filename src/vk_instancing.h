@@ -0,0 +1,78 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include "vk_mesh.h"
+#include "vk_uniform_ring.h"
+#include "vk_render_queue.h"
+
+// Automatic instancing of repeated meshes
+// Submitters add (pipeline, mesh, instance data) triples. Identical pipeline + mesh pairs share one batch, so however
+// many times a mesh is added it ends up as a single vkCmdDrawIndexed with instanceCount = the number of adds.
+// vk_instance_queue_build packs every batch's instance data back to back into one uniform ring allocation, recording
+// binds that allocation once on VK_MESH_INSTANCE_BINDING and selects each batch's slice through firstInstance.
+// Pipelines drawn through a queue need a vertex layout with an instance stream of the queue's instance_stride
+// (see vk_vertex_layout_add_instance_stream).
+
+struct vk_instance_key
+{
+    VkPipeline pipeline;
+    const vk_mesh_pool* pool;
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+
+    bool operator==(const vk_instance_key& other) const
+    {
+        return pipeline == other.pipeline && pool == other.pool && first_index == other.first_index &&
+               index_count == other.index_count && vertex_offset == other.vertex_offset;
+    }
+};
+
+struct vk_instance_key_hash
+{
+    size_t operator()(const vk_instance_key& key) const;
+};
+
+struct vk_instance_batch
+{
+    vk_instance_key key;
+    vk_mesh mesh;
+    std::vector<uint8_t> data;      // instance_count * instance_stride bytes
+    uint32_t instance_count;
+    uint32_t first_instance;        // Set by vk_instance_queue_build
+};
+
+struct vk_instance_queue
+{
+    uint32_t instance_stride;
+    // Batches are kept across frames (emptied by vk_instance_queue_begin) so their data vectors keep their capacity
+    std::vector<vk_instance_batch> batches;
+    std::unordered_map<vk_instance_key, uint32_t, vk_instance_key_hash> lookup;
+    std::vector<uint32_t> draws;    // Non empty batches in recording order, built by vk_instance_queue_build
+    VkBuffer instance_buffer;
+    VkDeviceSize instance_offset;
+    uint64_t instance_count;
+};
+
+int vk_instance_queue_create(uint32_t instance_stride, vk_instance_queue* queue);
+
+// Empties every batch, call once per frame before adding
+void vk_instance_queue_begin(vk_instance_queue& queue);
+
+// Adds count instances (count * instance_stride bytes of data) of mesh drawn with pipeline
+void vk_instance_queue_add(vk_instance_queue& queue, VkPipeline pipeline, const vk_mesh_pool& pool, const vk_mesh& mesh, const void* instances, uint32_t count);
+
+// Copies the instance data into the frame's uniform ring and orders the batches to minimize pipeline / mesh pool binds
+// Returns the number of draws to record (the item count for vk_instance_queue_record), -1 if the ring is full
+int vk_instance_queue_build(vk_instance_queue& queue, vk_uniform_ring& ring);
+
+// Submits the draws from the last build to render_queue in pass and points the render queue's instance stream at
+// this queue's data, so only one instance queue can feed a render queue per frame. push is pushed for every draw.
+// pipeline replaces the pipelines the draws were added with unless it is VK_NULL_HANDLE (e.g. a depth only pipeline
+// to submit the same draws again to a prepass)
+void vk_instance_queue_submit(const vk_instance_queue& queue, vk_render_queue& render_queue, uint8_t pass, VkPipeline pipeline, const void* push, uint32_t push_size);
+
+// Records draws [begin, end) from the last build
+// Binds pipelines, mesh pools and the instance buffer, the bindless heap / push constants / dynamic state are left to the caller
+void vk_instance_queue_record(VkCommandBuffer cmd, const vk_instance_queue& queue, uint32_t begin, uint32_t end);
@@ -0,0 +1,142 @@
+#include "vk_jobs.h"
+#include <atomic>
+#include <algorithm>
+
+static void worker_main(vk_job_system* jobs, uint32_t thread)
+{
+    while(true)
+    {
+        vk_job job;
+        {
+            std::unique_lock<std::mutex> guard(jobs->lock);
+            jobs->wake.wait(guard, [jobs]() { return jobs->stop || !jobs->queue.empty(); });
+            if(jobs->stop && jobs->queue.empty()) return;
+
+            job = std::move(jobs->queue.front());
+            jobs->queue.pop_front();
+            jobs->running++;
+        }
+
+        job(thread);
+
+        {
+            std::lock_guard<std::mutex> guard(jobs->lock);
+            jobs->running--;
+            if(jobs->running == 0 && jobs->queue.empty())
+            {
+                jobs->idle.notify_all();
+            }
+        }
+    }
+}
+
+int vk_job_system_create(vk_job_system* jobs, uint32_t worker_count)
+{
+    if(jobs == NULL) return -1;
+
+    if(worker_count == 0)
+    {
+        uint32_t hardware_threads = std::thread::hardware_concurrency();
+        worker_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+    }
+
+    jobs->running = 0;
+    jobs->stop = false;
+    for(uint32_t i = 0; i < worker_count; i++)
+    {
+        jobs->workers.emplace_back(worker_main, jobs, i + 1);
+    }
+
+    return 0;
+}
+
+void vk_job_system_destroy(vk_job_system& jobs)
+{
+    {
+        std::lock_guard<std::mutex> guard(jobs.lock);
+        jobs.stop = true;
+    }
+    jobs.wake.notify_all();
+
+    for(std::thread& worker : jobs.workers)
+    {
+        worker.join();
+    }
+    jobs.workers.clear();
+}
+
+uint32_t vk_job_thread_count(const vk_job_system& jobs)
+{
+    return jobs.workers.size() + 1;
+}
+
+void vk_job_submit(vk_job_system& jobs, vk_job job)
+{
+    {
+        std::lock_guard<std::mutex> guard(jobs.lock);
+        jobs.queue.push_back(std::move(job));
+    }
+    jobs.wake.notify_one();
+}
+
+void vk_job_wait(vk_job_system& jobs)
+{
+    std::unique_lock<std::mutex> guard(jobs.lock);
+    jobs.idle.wait(guard, [&jobs]() { return jobs.running == 0 && jobs.queue.empty(); });
+}
+
+void vk_job_parallel_for(vk_job_system& jobs, uint32_t count, uint32_t chunk_size, const std::function<void(uint32_t begin, uint32_t end, uint32_t thread)>& fn)
+{
+    if(count == 0) return;
+    chunk_size = std::max(chunk_size, 1u);
+
+    uint32_t chunk_count = (count + chunk_size - 1) / chunk_size;
+    if(chunk_count == 1 || jobs.workers.empty())
+    {
+        fn(0, count, 0);
+        return;
+    }
+
+    // Chunks are pulled from a shared counter so fast threads pick up the slack of slow ones
+    struct parallel_for_state
+    {
+        std::atomic<uint32_t> next_chunk;
+        std::atomic<uint32_t> helpers_left;
+        std::mutex lock;
+        std::condition_variable done;
+    };
+
+    parallel_for_state state;
+    state.next_chunk = 0;
+
+    auto run_chunks = [&state, &fn, count, chunk_size, chunk_count](uint32_t thread)
+    {
+        uint32_t chunk;
+        while((chunk = state.next_chunk.fetch_add(1)) < chunk_count)
+        {
+            uint32_t begin = chunk * chunk_size;
+            fn(begin, std::min(begin + chunk_size, count), thread);
+        }
+    };
+
+    uint32_t helper_count = std::min<uint32_t>(jobs.workers.size(), chunk_count - 1);
+    state.helpers_left = helper_count;
+
+    for(uint32_t i = 0; i < helper_count; i++)
+    {
+        vk_job_submit(jobs, [&state, &run_chunks](uint32_t thread)
+        {
+            run_chunks(thread);
+            std::lock_guard<std::mutex> guard(state.lock);
+            if(--state.helpers_left == 0)
+            {
+                state.done.notify_one();
+            }
+        });
+    }
+
+    run_chunks(0);
+
+    std::unique_lock<std::mutex> guard(state.lock);
+    state.done.wait(guard, [&state]() { return state.helpers_left == 0; });
+}
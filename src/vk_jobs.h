@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+// Small fixed size worker pool shared by everything in vklib that wants to go wide
+// Thread index 0 is always the thread that called into the job system, workers are 1..worker_count,
+// so per-thread resources should be sized vk_job_thread_count().
+
+typedef std::function<void(uint32_t thread)> vk_job;
+
+struct vk_job_system
+{
+    std::vector<std::thread> workers;
+    std::deque<vk_job> queue;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    uint32_t running;
+    bool stop;
+};
+
+// worker_count == 0 picks one worker per hardware thread minus the calling thread
+int vk_job_system_create(vk_job_system* jobs, uint32_t worker_count);
+void vk_job_system_destroy(vk_job_system& jobs);
+
+// Number of distinct thread indices jobs can see (workers + calling thread)
+uint32_t vk_job_thread_count(const vk_job_system& jobs);
+
+void vk_job_submit(vk_job_system& jobs, vk_job job);
+
+// Blocks until every submitted job has finished
+void vk_job_wait(vk_job_system& jobs);
+
+// Calls fn(begin, end, thread) for chunks of [0, count) on the workers and the calling thread, returns once all are done
+// Must not be called from inside a job, the calling thread always runs as thread 0
+void vk_job_parallel_for(vk_job_system& jobs, uint32_t count, uint32_t chunk_size, const std::function<void(uint32_t begin, uint32_t end, uint32_t thread)>& fn);
@@ -0,0 +1,100 @@
+#include "vk_mesh.h"
+#include <iostream>
+
+int vk_mesh_pool_create(vk_allocator& allocator, const vk_vertex_layout& layout, uint32_t vertex_capacity, uint32_t index_capacity, vk_mesh_pool* pool)
+{
+    if(pool == NULL || layout.bindings.empty()) return -1;
+
+    pool->vertex_stride = layout.bindings[0].stride;
+    pool->vertex_capacity = vertex_capacity;
+    pool->vertex_count = 0;
+    pool->index_capacity = index_capacity;
+    pool->index_count = 0;
+
+    if(vk_buffer_create(allocator, (VkDeviceSize)vertex_capacity * pool->vertex_stride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &pool->vertex_buffer) < 0)
+    {
+        std::cerr << "Failed to create mesh pool vertex buffer" << std::endl;
+        return -1;
+    }
+
+    if(vk_buffer_create(allocator, (VkDeviceSize)index_capacity * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &pool->index_buffer) < 0)
+    {
+        std::cerr << "Failed to create mesh pool index buffer" << std::endl;
+        vk_buffer_destroy(allocator, pool->vertex_buffer);
+        return -1;
+    }
+
+    return 0;
+}
+
+void vk_mesh_pool_destroy(vk_allocator& allocator, vk_mesh_pool& pool)
+{
+    vk_buffer_destroy(allocator, pool.vertex_buffer);
+    vk_buffer_destroy(allocator, pool.index_buffer);
+}
+
+void vk_mesh_pool_reset(vk_mesh_pool& pool)
+{
+    pool.vertex_count = 0;
+    pool.index_count = 0;
+}
+
+int vk_mesh_create(vk_mesh_pool& pool, vk_staging_ring& ring, const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, vk_mesh* mesh)
+{
+    if(mesh == NULL) return -1;
+
+    if(pool.vertex_count + vertex_count > pool.vertex_capacity || pool.index_count + index_count > pool.index_capacity)
+    {
+        std::cerr << "Mesh pool is full" << std::endl;
+        return -1;
+    }
+
+    VkDeviceSize vertex_offset = (VkDeviceSize)pool.vertex_count * pool.vertex_stride;
+    VkDeviceSize vertex_size = (VkDeviceSize)vertex_count * pool.vertex_stride;
+    VkDeviceSize index_offset = (VkDeviceSize)pool.index_count * sizeof(uint32_t);
+    VkDeviceSize index_size = (VkDeviceSize)index_count * sizeof(uint32_t);
+
+    // Both halves have to make it into the ring, don't leave a mesh with only its vertices queued
+    VkDeviceSize head = ring.head;
+    size_t pending = ring.pending.size();
+    if(vk_staging_ring_upload(ring, pool.vertex_buffer.buffer, vertex_offset, vertices, vertex_size) < 0 ||
+       vk_staging_ring_upload(ring, pool.index_buffer.buffer, index_offset, indices, index_size) < 0)
+    {
+        ring.head = head;
+        ring.pending.resize(pending);
+        return -1;
+    }
+
+    mesh->vertex_offset = (int32_t)pool.vertex_count;
+    mesh->vertex_count = vertex_count;
+    mesh->first_index = pool.index_count;
+    mesh->index_count = index_count;
+
+    pool.vertex_count += vertex_count;
+    pool.index_count += index_count;
+
+    return 0;
+}
+
+void vk_mesh_pool_bind(VkCommandBuffer cmd, const vk_mesh_pool& pool)
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &pool.vertex_buffer.buffer, &offset);
+    vkCmdBindIndexBuffer(cmd, pool.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void vk_mesh_draw(VkCommandBuffer cmd, const vk_mesh& mesh, uint32_t instance_count, uint32_t first_instance)
+{
+    vkCmdDrawIndexed(cmd, mesh.index_count, instance_count, mesh.first_index, mesh.vertex_offset, first_instance);
+}
+
+void vk_vertex_layout_add_instance_stream(vk_vertex_layout& layout, uint32_t stride, const std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+    layout.bindings.push_back(VkVertexInputBindingDescription{ VK_MESH_INSTANCE_BINDING, stride, VK_VERTEX_INPUT_RATE_INSTANCE });
+
+    for(VkVertexInputAttributeDescription attribute : attributes)
+    {
+        attribute.binding = VK_MESH_INSTANCE_BINDING;
+        layout.attributes.push_back(attribute);
+    }
+}
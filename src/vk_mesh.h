@@ -0,0 +1,57 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "vk_allocator.h"
+#include "vk_staging.h"
+
+// Binding per instance data is read from, mesh vertices are always binding 0 (see vk_instancing.h)
+#define VK_MESH_INSTANCE_BINDING 1
+
+// Describes the vertex buffers / attributes a pipeline reads, see vk_pipeline_config
+struct vk_vertex_layout
+{
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+// Adds a VK_VERTEX_INPUT_RATE_INSTANCE binding on VK_MESH_INSTANCE_BINDING with stride bytes per instance
+// attributes are moved onto that binding, their offsets are relative to the start of an instance
+void vk_vertex_layout_add_instance_stream(vk_vertex_layout& layout, uint32_t stride, const std::vector<VkVertexInputAttributeDescription>& attributes);
+
+// Device local vertex + index storage shared by many meshes
+// Every mesh in a pool uses the pool's vertex layout (binding 0) and 32 bit indices, so a whole scene can be drawn
+// with a single pair of buffer binds and individual meshes are just ranges within the buffers.
+struct vk_mesh_pool
+{
+    vk_buffer vertex_buffer;
+    vk_buffer index_buffer;
+    uint32_t vertex_stride;
+    uint32_t vertex_capacity;
+    uint32_t vertex_count;
+    uint32_t index_capacity;
+    uint32_t index_count;
+};
+
+struct vk_mesh
+{
+    int32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+int vk_mesh_pool_create(vk_allocator& allocator, const vk_vertex_layout& layout, uint32_t vertex_capacity, uint32_t index_capacity, vk_mesh_pool* pool);
+void vk_mesh_pool_destroy(vk_allocator& allocator, vk_mesh_pool& pool);
+
+// Forgets every mesh in the pool, only safe once the GPU is done with all of them
+void vk_mesh_pool_reset(vk_mesh_pool& pool);
+
+// Reserves space for the mesh in the pool and queues its data on the staging ring
+// The data is only visible to the GPU after the ring has been recorded (vk_staging_ring_record) into a submitted command buffer
+// 0 - success
+// -1 - the pool or the staging ring is full
+int vk_mesh_create(vk_mesh_pool& pool, vk_staging_ring& ring, const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, vk_mesh* mesh);
+
+// Binds the pool's vertex buffer to binding 0 and its index buffer
+void vk_mesh_pool_bind(VkCommandBuffer cmd, const vk_mesh_pool& pool);
+void vk_mesh_draw(VkCommandBuffer cmd, const vk_mesh& mesh, uint32_t instance_count, uint32_t first_instance);
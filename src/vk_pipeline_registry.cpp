@@ -0,0 +1,235 @@
+#include "vk_pipeline_registry.h"
+#include <iostream>
+#include <atomic>
+
+static void key_append(std::string& key, const void* data, size_t size)
+{
+    key.append((const char*)data, size);
+}
+
+template<typename T>
+static void key_append(std::string& key, const T& value)
+{
+    key_append(key, &value, sizeof(T));
+}
+
+// Appends fields one by one rather than whole structs so padding never ends up in the key
+static std::string pipeline_key(const vk_context& context, const vk_pipeline_config& config, VkPipelineLayout layout)
+{
+    std::string key;
+    key.reserve(256);
+
+    key_append(key, config.shader.vertex);
+    key_append(key, config.shader.fragment);
+
+    key_append(key, (uint32_t)config.vertex_layout.bindings.size());
+    for(const VkVertexInputBindingDescription& binding : config.vertex_layout.bindings)
+    {
+        key_append(key, binding.binding);
+        key_append(key, binding.stride);
+        key_append(key, binding.inputRate);
+    }
+
+    key_append(key, (uint32_t)config.vertex_layout.attributes.size());
+    for(const VkVertexInputAttributeDescription& attribute : config.vertex_layout.attributes)
+    {
+        key_append(key, attribute.location);
+        key_append(key, attribute.binding);
+        key_append(key, attribute.format);
+        key_append(key, attribute.offset);
+    }
+
+    key_append(key, config.topology);
+    key_append(key, config.polygon_mode);
+    key_append(key, config.cull_mode);
+    key_append(key, config.front_face);
+    key_append(key, config.depth_test);
+    key_append(key, config.depth_write);
+    key_append(key, config.depth_compare);
+    key_append(key, config.stencil_test);
+    for(const VkStencilOpState* stencil : { &config.stencil_front, &config.stencil_back })
+    {
+        key_append(key, stencil->failOp);
+        key_append(key, stencil->passOp);
+        key_append(key, stencil->depthFailOp);
+        key_append(key, stencil->compareOp);
+        key_append(key, stencil->compareMask);
+        key_append(key, stencil->writeMask);
+        key_append(key, stencil->reference);
+    }
+
+    key_append(key, config.blend.enable);
+    key_append(key, config.blend.src_color);
+    key_append(key, config.blend.dst_color);
+    key_append(key, config.blend.color_op);
+    key_append(key, config.blend.src_alpha);
+    key_append(key, config.blend.dst_alpha);
+    key_append(key, config.blend.alpha_op);
+    key_append(key, config.blend.write_mask);
+
+    // An empty format list means the context's format, resolve it so both spellings share a pipeline
+    if(config.depth_only)
+    {
+        key_append(key, (uint32_t)0);
+    }
+    else if(config.color_formats.empty())
+    {
+        key_append(key, (uint32_t)1);
+        key_append(key, vk_get_color_format(context));
+    }
+    else
+    {
+        key_append(key, (uint32_t)config.color_formats.size());
+        key_append(key, config.color_formats.data(), config.color_formats.size() * sizeof(VkFormat));
+    }
+    key_append(key, config.depth_format);
+    key_append(key, config.stencil_format);
+    key_append(key, config.samples);
+
+    key_append(key, layout);
+
+    return key;
+}
+
+int vk_pipeline_registry_create(vk_context& context, vk_pipeline_registry* registry)
+{
+    if(registry == NULL) return -1;
+
+    registry->requested = 0;
+    registry->compiled = 0;
+
+    return 0;
+}
+
+void vk_pipeline_registry_destroy(vk_context& context, vk_pipeline_registry& registry)
+{
+    for(vk_dynamic_pipeline& pipeline : registry.pipelines)
+    {
+        vkDestroyPipeline(context.logical_device, pipeline.pipeline, NULL);
+    }
+
+    registry.pipelines.clear();
+    registry.lookup.clear();
+}
+
+int vk_pipeline_registry_get(vk_context& context, vk_pipeline_registry& registry, vk_job_system* jobs, const vk_pipeline_config* configs, uint32_t count, vk_dynamic_pipeline* pipelines)
+{
+    if(count == 0) return 0;
+    if(configs == NULL || pipelines == NULL) return -1;
+
+    std::vector<std::string> keys(count);
+    std::vector<VkPipelineLayout> layouts(count);
+
+    // Configs that aren't registered yet, duplicates within the batch only get compiled once
+    std::vector<uint32_t> missing;
+    std::unordered_map<std::string, uint32_t> batch_lookup;
+    std::vector<uint32_t> batch_index(count, UINT32_MAX);
+
+    {
+        std::lock_guard<std::mutex> guard(registry.lock);
+        registry.requested += count;
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            layouts[i] = configs[i].layout != VK_NULL_HANDLE ? configs[i].layout : context.bindless.pipeline_layout;
+            keys[i] = pipeline_key(context, configs[i], layouts[i]);
+
+            auto found = registry.lookup.find(keys[i]);
+            if(found != registry.lookup.end())
+            {
+                pipelines[i] = registry.pipelines[found->second];
+                continue;
+            }
+
+            auto pending = batch_lookup.find(keys[i]);
+            if(pending != batch_lookup.end())
+            {
+                batch_index[i] = pending->second;
+                continue;
+            }
+
+            batch_index[i] = missing.size();
+            batch_lookup.emplace(keys[i], (uint32_t)missing.size());
+            missing.push_back(i);
+        }
+    }
+
+    if(missing.empty()) return 0;
+
+    // Compiling happens without the lock so other threads can keep looking up pipelines meanwhile
+    // (two threads racing on the same new config both compile it, the loser's copy is destroyed below)
+    std::vector<VkPipeline> compiled(missing.size(), VK_NULL_HANDLE);
+    std::atomic<bool> failed(false);
+
+    auto compile = [&](uint32_t begin, uint32_t end, uint32_t thread)
+    {
+        for(uint32_t batch_begin = begin; batch_begin < end; batch_begin += VK_PIPELINE_REGISTRY_BATCH_SIZE)
+        {
+            uint32_t batch_end = batch_begin + VK_PIPELINE_REGISTRY_BATCH_SIZE < end ? batch_begin + VK_PIPELINE_REGISTRY_BATCH_SIZE : end;
+
+            std::vector<vk_pipeline_build_state> states(batch_end - batch_begin);
+            std::vector<VkGraphicsPipelineCreateInfo> infos(batch_end - batch_begin);
+            for(uint32_t i = batch_begin; i < batch_end; i++)
+            {
+                uint32_t config = missing[i];
+                vk_pipeline_build_state_init(context, configs[config], layouts[config], &states[i - batch_begin]);
+                infos[i - batch_begin] = states[i - batch_begin].info;
+            }
+
+            // On failure the driver sets the pipelines it couldn't create to VK_NULL_HANDLE, keep the rest
+            if(vkCreateGraphicsPipelines(context.logical_device, context.pipeline_cache, infos.size(), infos.data(), NULL, &compiled[batch_begin]) != VK_SUCCESS)
+            {
+                failed = true;
+            }
+        }
+    };
+
+    if(jobs != NULL)
+    {
+        vk_job_parallel_for(*jobs, missing.size(), VK_PIPELINE_REGISTRY_BATCH_SIZE, compile);
+    }
+    else
+    {
+        compile(0, missing.size(), 0);
+    }
+
+    std::lock_guard<std::mutex> guard(registry.lock);
+
+    for(uint32_t i = 0; i < missing.size(); i++)
+    {
+        if(compiled[i] == VK_NULL_HANDLE) continue;
+
+        uint32_t config = missing[i];
+        auto found = registry.lookup.find(keys[config]);
+        if(found != registry.lookup.end())
+        {
+            vkDestroyPipeline(context.logical_device, compiled[i], NULL);
+            compiled[i] = registry.pipelines[found->second].pipeline;
+            continue;
+        }
+
+        vk_dynamic_pipeline pipeline{};
+        pipeline.pipeline = compiled[i];
+        pipeline.layout = layouts[config];
+
+        registry.lookup.emplace(keys[config], (uint32_t)registry.pipelines.size());
+        registry.pipelines.push_back(pipeline);
+        registry.compiled++;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(batch_index[i] == UINT32_MAX) continue;
+
+        pipelines[i].pipeline = compiled[batch_index[i]];
+        pipelines[i].layout = layouts[i];
+    }
+
+    if(failed)
+    {
+        std::cerr << "Failed to create graphics pipeline" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include "vklib.h"
+#include "vk_jobs.h"
+
+// Deduplicating pipeline store
+// Configs are reduced to a byte key covering every piece of state that ends up in the VkGraphicsPipelineCreateInfo
+// (shader modules, vertex layout, raster / blend / depth state, attachment formats, layout), identical configs share one
+// VkPipeline and configs without a layout get the bindless heap's shared layout. Whatever is missing from a batch gets
+// compiled across the job system, several pipelines per vkCreateGraphicsPipelines call.
+// Shader modules are part of the key by handle, so configs should reuse the same vk_shader rather than reloading it and
+// modules have to outlive the registry (a destroyed module's handle can be handed out again for a different shader).
+
+// Pipelines handed to each vkCreateGraphicsPipelines call when compiling a batch
+#define VK_PIPELINE_REGISTRY_BATCH_SIZE 8
+
+struct vk_pipeline_registry
+{
+    std::unordered_map<std::string, uint32_t> lookup;  // Config key -> index into pipelines
+    std::vector<vk_dynamic_pipeline> pipelines;
+    std::mutex lock;
+    uint64_t requested;     // Pipelines asked for through vk_pipeline_registry_get
+    uint64_t compiled;      // Pipelines that actually had to be created
+};
+
+int vk_pipeline_registry_create(vk_context& context, vk_pipeline_registry* registry);
+void vk_pipeline_registry_destroy(vk_context& context, vk_pipeline_registry& registry);
+
+// Writes a pipeline for each of the count configs into pipelines, creating the ones that don't exist yet
+// jobs may be NULL to compile on the calling thread only. The returned pipelines are owned by the registry.
+// 0 - success
+// -1 - failure (pipelines that did compile are still registered)
+int vk_pipeline_registry_get(vk_context& context, vk_pipeline_registry& registry, vk_job_system* jobs, const vk_pipeline_config* configs, uint32_t count, vk_dynamic_pipeline* pipelines);
@@ -0,0 +1,176 @@
+#include "vk_queue.h"
+#include "vklib.h"
+#include <iostream>
+
+int vk_async_queue_create(vk_context& context, uint32_t family, vk_async_queue* queue)
+{
+    if(queue == NULL) return -1;
+
+    queue->family = family;
+    queue->submitted = 0;
+    vkGetDeviceQueue(context.logical_device, family, 0, &queue->queue);
+
+    VkSemaphoreTypeCreateInfo type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &type_info;
+
+    if(vkCreateSemaphore(context.logical_device, &semaphore_info, NULL, &queue->timeline) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create timeline semaphore" << std::endl;
+        return -1;
+    }
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = family;
+
+    if(vkCreateCommandPool(context.logical_device, &pool_info, NULL, &queue->command_pool) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create async queue command pool" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+void vk_async_queue_destroy(vk_context& context, vk_async_queue& queue)
+{
+    vk_async_queue_wait(context, queue, queue.submitted, UINT64_MAX);
+
+    vkDestroyCommandPool(context.logical_device, queue.command_pool, NULL);
+    vkDestroySemaphore(context.logical_device, queue.timeline, NULL);
+
+    queue.buffers.clear();
+    queue.buffer_values.clear();
+}
+
+VkCommandBuffer vk_async_queue_begin(vk_context& context, vk_async_queue& queue)
+{
+    uint64_t completed = vk_async_queue_completed(context, queue);
+
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    for(size_t i = 0; i < queue.buffers.size(); i++)
+    {
+        if(queue.buffer_values[i] <= completed)
+        {
+            cmd = queue.buffers[i];
+            queue.buffer_values[i] = UINT64_MAX;    // Claimed until submitted
+            vkResetCommandBuffer(cmd, 0);
+            break;
+        }
+    }
+
+    if(cmd == VK_NULL_HANDLE)
+    {
+        VkCommandBufferAllocateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        buffer_info.commandPool = queue.command_pool;
+        buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        buffer_info.commandBufferCount = 1;
+
+        if(vkAllocateCommandBuffers(context.logical_device, &buffer_info, &cmd) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to allocate async queue command buffer" << std::endl;
+            return VK_NULL_HANDLE;
+        }
+
+        queue.buffers.push_back(cmd);
+        queue.buffer_values.push_back(UINT64_MAX);
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if(vkBeginCommandBuffer(cmd, &begin_info) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to begin async queue command buffer" << std::endl;
+        return VK_NULL_HANDLE;
+    }
+
+    return cmd;
+}
+
+uint64_t vk_async_queue_submit(vk_context& context, vk_async_queue& queue, VkCommandBuffer cmd, const VkSemaphoreSubmitInfo* waits, uint32_t wait_count)
+{
+    if(vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to end async queue command buffer" << std::endl;
+        return 0;
+    }
+
+    uint64_t value = queue.submitted + 1;
+
+    VkCommandBufferSubmitInfo cmd_info{};
+    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    cmd_info.commandBuffer = cmd;
+
+    VkSemaphoreSubmitInfo signal_info{};
+    signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal_info.semaphore = queue.timeline;
+    signal_info.value = value;
+    signal_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo2 submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submit_info.waitSemaphoreInfoCount = wait_count;
+    submit_info.pWaitSemaphoreInfos = waits;
+    submit_info.commandBufferInfoCount = 1;
+    submit_info.pCommandBufferInfos = &cmd_info;
+    submit_info.signalSemaphoreInfoCount = 1;
+    submit_info.pSignalSemaphoreInfos = &signal_info;
+
+    if(vkQueueSubmit2(queue.queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to submit to async queue" << std::endl;
+        return 0;
+    }
+
+    for(size_t i = 0; i < queue.buffers.size(); i++)
+    {
+        if(queue.buffers[i] == cmd)
+        {
+            queue.buffer_values[i] = value;
+            break;
+        }
+    }
+
+    queue.submitted = value;
+    return value;
+}
+
+uint64_t vk_async_queue_completed(vk_context& context, const vk_async_queue& queue)
+{
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(context.logical_device, queue.timeline, &value);
+    return value;
+}
+
+int vk_async_queue_wait(vk_context& context, const vk_async_queue& queue, uint64_t value, uint64_t timeout)
+{
+    if(value == 0) return 0;
+
+    VkSemaphoreWaitInfo wait_info{};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &queue.timeline;
+    wait_info.pValues = &value;
+
+    return vkWaitSemaphores(context.logical_device, &wait_info, timeout) == VK_SUCCESS ? 0 : -1;
+}
+
+VkSemaphoreSubmitInfo vk_async_queue_wait_info(const vk_async_queue& queue, uint64_t value, VkPipelineStageFlags2 stages)
+{
+    VkSemaphoreSubmitInfo wait_info{};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    wait_info.semaphore = queue.timeline;
+    wait_info.value = value;
+    wait_info.stageMask = stages;
+    return wait_info;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+struct vk_context;
+
+// Submission to the dedicated transfer / async compute queues
+// Each queue owns a timeline semaphore that its submissions signal with increasing values, so "has this upload finished"
+// is a counter compare and other queues synchronize with it by waiting on a (semaphore, value) pair instead of a
+// binary semaphore per submission. When the device has no dedicated family the queue simply lives on the graphics family.
+
+struct vk_async_queue
+{
+    VkQueue queue;
+    uint32_t family;
+    VkSemaphore timeline;
+    uint64_t submitted;                     // Value signaled by the most recent submission
+    VkCommandPool command_pool;
+    std::vector<VkCommandBuffer> buffers;
+    std::vector<uint64_t> buffer_values;    // Timeline value each buffer was last submitted with, reusable once reached
+};
+
+int vk_async_queue_create(vk_context& context, uint32_t family, vk_async_queue* queue);
+
+// Waits for all outstanding work on the queue before destroying it
+void vk_async_queue_destroy(vk_context& context, vk_async_queue& queue);
+
+// Returns a begun one time submit command buffer or VK_NULL_HANDLE on failure
+VkCommandBuffer vk_async_queue_begin(vk_context& context, vk_async_queue& queue);
+
+// Ends cmd and submits it after waits, returns the timeline value signaled once it completes or 0 on failure
+uint64_t vk_async_queue_submit(vk_context& context, vk_async_queue& queue, VkCommandBuffer cmd, const VkSemaphoreSubmitInfo* waits, uint32_t wait_count);
+
+// Highest timeline value the queue has reached, every submission with a value <= this has completed
+uint64_t vk_async_queue_completed(vk_context& context, const vk_async_queue& queue);
+
+// 0 - value reached
+// -1 - timeout or failure
+int vk_async_queue_wait(vk_context& context, const vk_async_queue& queue, uint64_t value, uint64_t timeout);
+
+// Wait info for a submission on another queue that must not run stages until this queue has reached value
+VkSemaphoreSubmitInfo vk_async_queue_wait_info(const vk_async_queue& queue, uint64_t value, VkPipelineStageFlags2 stages);
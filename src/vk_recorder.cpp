@@ -0,0 +1,176 @@
+#include "vk_recorder.h"
+#include "vklib.h"
+#include "vk_cpu_profiler.h"
+#include "vk_gpu_profiler.h"
+#include <iostream>
+#include <atomic>
+
+int vk_parallel_recorder_create(vk_context& context, uint32_t queue_family, uint32_t thread_count, uint32_t frames_in_flight, vk_parallel_recorder* recorder)
+{
+    if(recorder == NULL || thread_count == 0 || frames_in_flight == 0) return -1;
+
+    recorder->thread_count = thread_count;
+    recorder->frames_in_flight = frames_in_flight;
+    recorder->pools.resize(thread_count * frames_in_flight);
+    recorder->primaries.resize(frames_in_flight);
+
+    // Transient since everything gets re-recorded every frame, no per-buffer reset flag since only whole pools get reset
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+
+    for(vk_thread_pool& pool : recorder->pools)
+    {
+        pool.used = 0;
+        if(vkCreateCommandPool(context.logical_device, &pool_info, NULL, &pool.pool) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to create recording command pool" << std::endl;
+            return -1;
+        }
+    }
+
+    for(uint32_t frame = 0; frame < frames_in_flight; frame++)
+    {
+        VkCommandBufferAllocateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        buffer_info.commandPool = recorder->pools[frame * thread_count].pool;
+        buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        buffer_info.commandBufferCount = 1;
+
+        if(vkAllocateCommandBuffers(context.logical_device, &buffer_info, &recorder->primaries[frame]) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to allocate primary command buffer" << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void vk_parallel_recorder_destroy(vk_context& context, vk_parallel_recorder& recorder)
+{
+    for(vk_thread_pool& pool : recorder.pools)
+    {
+        vkDestroyCommandPool(context.logical_device, pool.pool, NULL);
+    }
+
+    recorder.pools.clear();
+    recorder.primaries.clear();
+}
+
+VkCommandBuffer vk_parallel_recorder_begin_frame(vk_context& context, vk_parallel_recorder& recorder, uint32_t frame)
+{
+    for(uint32_t thread = 0; thread < recorder.thread_count; thread++)
+    {
+        vk_thread_pool& pool = recorder.pools[frame * recorder.thread_count + thread];
+        vkResetCommandPool(context.logical_device, pool.pool, 0);
+        pool.used = 0;
+    }
+
+    return recorder.primaries[frame];
+}
+
+// Only ever called by the thread that owns pool, so no locking
+static VkCommandBuffer next_secondary(vk_context& context, vk_thread_pool& pool)
+{
+    if(pool.used == pool.secondaries.size())
+    {
+        VkCommandBufferAllocateInfo buffer_info{};
+        buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        buffer_info.commandPool = pool.pool;
+        buffer_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        buffer_info.commandBufferCount = 1;
+
+        VkCommandBuffer buffer;
+        if(vkAllocateCommandBuffers(context.logical_device, &buffer_info, &buffer) != VK_SUCCESS)
+        {
+            return VK_NULL_HANDLE;
+        }
+        pool.secondaries.push_back(buffer);
+    }
+
+    return pool.secondaries[pool.used++];
+}
+
+int vk_parallel_record(vk_context& context, vk_parallel_recorder& recorder, vk_job_system& jobs, uint32_t frame, VkCommandBuffer primary,
+                       const vk_rendering_formats& formats, uint32_t item_count, uint32_t items_per_task, const vk_record_fn& record)
+{
+    VK_CPU_ZONE("vk_parallel_record");
+
+    if(item_count == 0) return 0;
+    if(vk_job_thread_count(jobs) > recorder.thread_count)
+    {
+        std::cerr << "Parallel recorder has fewer command pools than the job system has threads" << std::endl;
+        return -1;
+    }
+
+    items_per_task = items_per_task > 0 ? items_per_task : 1;
+    uint32_t task_count = (item_count + items_per_task - 1) / items_per_task;
+
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering{};
+    inheritance_rendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    inheritance_rendering.colorAttachmentCount = formats.color_formats.size();
+    inheritance_rendering.pColorAttachmentFormats = formats.color_formats.data();
+    inheritance_rendering.depthAttachmentFormat = formats.depth_format;
+    inheritance_rendering.stencilAttachmentFormat = formats.stencil_format;
+    inheritance_rendering.rasterizationSamples = formats.samples ? formats.samples : VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.pNext = &inheritance_rendering;
+
+    // The GPU profiler may have a statistics query running around the pass
+    if(context.pipeline_statistics)
+    {
+        inheritance.pipelineStatistics = VK_GPU_PROFILER_STATISTICS;
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance;
+
+    // Results are stored by task index so execution order doesn't depend on which thread finished first
+    recorder.recorded.assign(task_count, VK_NULL_HANDLE);
+    std::atomic<bool> failed(false);
+
+    vk_job_parallel_for(jobs, task_count, 1, [&](uint32_t begin_task, uint32_t end_task, uint32_t thread)
+    {
+        vk_thread_pool& pool = recorder.pools[frame * recorder.thread_count + thread];
+
+        for(uint32_t task = begin_task; task < end_task; task++)
+        {
+            VK_CPU_ZONE("record_task");
+
+            VkCommandBuffer cmd = next_secondary(context, pool);
+            if(cmd == VK_NULL_HANDLE || vkBeginCommandBuffer(cmd, &begin_info) != VK_SUCCESS)
+            {
+                failed = true;
+                return;
+            }
+
+            uint32_t begin = task * items_per_task;
+            uint32_t end = begin + items_per_task < item_count ? begin + items_per_task : item_count;
+            record(cmd, begin, end);
+
+            if(vkEndCommandBuffer(cmd) != VK_SUCCESS)
+            {
+                failed = true;
+                return;
+            }
+
+            recorder.recorded[task] = cmd;
+        }
+    });
+
+    if(failed)
+    {
+        std::cerr << "Failed to record secondary command buffers" << std::endl;
+        return -1;
+    }
+
+    vkCmdExecuteCommands(primary, recorder.recorded.size(), recorder.recorded.data());
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+#include "vk_jobs.h"
+
+struct vk_context;
+
+// Parallel command recording for dynamic rendering
+// Every (frame in flight, thread) pair owns a command pool. Pools are reset wholesale once per frame with
+// vkResetCommandPool and their command buffers reused, so individual buffers are never reset or freed.
+// Workers record secondary command buffers that inherit the rendering state of the primary's vkCmdBeginRendering
+// and the primary stitches them back together in submission order with vkCmdExecuteCommands.
+
+struct vk_thread_pool
+{
+    VkCommandPool pool;
+    std::vector<VkCommandBuffer> secondaries;
+    uint32_t used;
+};
+
+struct vk_parallel_recorder
+{
+    uint32_t thread_count;
+    uint32_t frames_in_flight;
+    std::vector<vk_thread_pool> pools;      // [frame * thread_count + thread]
+    std::vector<VkCommandBuffer> primaries; // One per frame, allocated from that frame's thread 0 pool
+    std::vector<VkCommandBuffer> recorded;  // Scratch list of the secondaries recorded by the last vk_parallel_record
+};
+
+// Attachment formats of the rendering scope secondaries are recorded for, must match vkCmdBeginRendering
+struct vk_rendering_formats
+{
+    std::vector<VkFormat> color_formats;
+    VkFormat depth_format;
+    VkFormat stencil_format;
+    VkSampleCountFlagBits samples;
+};
+
+// Records items [begin, end) into a secondary command buffer, dynamic state (viewport / scissor) is not inherited
+typedef std::function<void(VkCommandBuffer cmd, uint32_t begin, uint32_t end)> vk_record_fn;
+
+int vk_parallel_recorder_create(vk_context& context, uint32_t queue_family, uint32_t thread_count, uint32_t frames_in_flight, vk_parallel_recorder* recorder);
+void vk_parallel_recorder_destroy(vk_context& context, vk_parallel_recorder& recorder);
+
+// Resets every pool belonging to frame and returns its primary command buffer (not yet begun)
+// Only call once the frame's previous submission has completed
+VkCommandBuffer vk_parallel_recorder_begin_frame(vk_context& context, vk_parallel_recorder& recorder, uint32_t frame);
+
+// Splits item_count items into tasks of items_per_task, records them across the job system and executes the results
+// into primary, which must be inside a vkCmdBeginRendering with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT
+// 0 - success
+// -1 - failure
+int vk_parallel_record(vk_context& context, vk_parallel_recorder& recorder, vk_job_system& jobs, uint32_t frame, VkCommandBuffer primary,
+                       const vk_rendering_formats& formats, uint32_t item_count, uint32_t items_per_task, const vk_record_fn& record);
@@ -0,0 +1,794 @@
+#include "vk_render_graph.h"
+#include "vklib.h"
+#include "vk_cpu_profiler.h"
+#include <iostream>
+#include <algorithm>
+
+// Every access flag that makes a use a write
+static const VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+                                           VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                           VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+// Access / visibility of one resource while walking the passes in order
+struct rg_visibility
+{
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+};
+
+struct rg_state
+{
+    VkImageLayout layout;
+    VkPipelineStageFlags2 write_stages;     // Stages of the last write or layout transition
+    VkAccessFlags2 write_access;
+    VkPipelineStageFlags2 read_stages;      // Stages that read since then
+    std::vector<rg_visibility> visible;     // Reads the last write was already made visible to
+};
+
+static VkImageUsageFlags usage_for_access(VkAccessFlags2 access, VkImageLayout layout)
+{
+    VkImageUsageFlags usage = 0;
+    if(access & (VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT)) usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if(access & (VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT)) usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if(access & VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT) usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    if(access & VK_ACCESS_2_SHADER_SAMPLED_READ_BIT) usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+    if(access & (VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT)) usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    if(access & VK_ACCESS_2_SHADER_READ_BIT) usage |= layout == VK_IMAGE_LAYOUT_GENERAL ? VK_IMAGE_USAGE_STORAGE_BIT : VK_IMAGE_USAGE_SAMPLED_BIT;
+    if(access & VK_ACCESS_2_TRANSFER_READ_BIT) usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    if(access & VK_ACCESS_2_TRANSFER_WRITE_BIT) usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    return usage;
+}
+
+// Usages an image can have and still live entirely in tile memory
+static const VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+static bool valid_pass(vk_render_graph& graph, uint32_t pass)
+{
+    if(pass < graph.passes.size()) return true;
+
+    std::cerr << "Render graph pass " << pass << " does not exist" << std::endl;
+    graph.invalid = 1;
+    return false;
+}
+
+// Uses of the same resource within a pass are merged, a pass can only see an image in one layout
+static void add_use(vk_render_graph& graph, uint32_t pass, uint32_t resource, uint8_t image, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout)
+{
+    if(!valid_pass(graph, pass)) return;
+
+    if(resource >= (image ? graph.images.size() : graph.buffers.size()))
+    {
+        std::cerr << "Render graph pass " << graph.passes[pass].name << " uses an unknown " << (image ? "image" : "buffer") << std::endl;
+        graph.invalid = 1;
+        return;
+    }
+
+    for(vk_rg_use& use : graph.passes[pass].uses)
+    {
+        if(use.resource != resource || use.image != image) continue;
+
+        if(image && use.layout != layout)
+        {
+            std::cerr << "Render graph pass " << graph.passes[pass].name << " uses an image in two layouts" << std::endl;
+            graph.invalid = 1;
+            return;
+        }
+
+        use.stages |= stages;
+        use.access |= access;
+        return;
+    }
+
+    graph.passes[pass].uses.push_back(vk_rg_use{ resource, image, stages, access, layout });
+}
+
+// Moves the physical transients and their memory to the retired list, destroyed once serial has completed
+static void retire_physical(vk_render_graph& graph, uint64_t serial)
+{
+    if(graph.physical.empty() && graph.slots.empty()) return;
+
+    vk_rg_retired retired;
+    retired.serial = serial;
+    for(vk_rg_physical_image& physical : graph.physical)
+    {
+        if(physical.view != VK_NULL_HANDLE) retired.views.push_back(physical.view);
+        if(physical.image != VK_NULL_HANDLE) retired.images.push_back(physical.image);
+    }
+    for(vk_rg_slot& slot : graph.slots)
+    {
+        if(slot.allocation.memory != VK_NULL_HANDLE) retired.allocations.push_back(slot.allocation);
+    }
+
+    graph.retired.push_back(retired);
+    graph.physical.clear();
+    graph.slots.clear();
+    graph.transient_bytes = 0;
+    graph.unaliased_bytes = 0;
+    graph.lazy_bytes = 0;
+}
+
+static void destroy_retired(vk_context& context, vk_rg_retired& retired)
+{
+    for(VkImageView view : retired.views) vkDestroyImageView(context.logical_device, view, NULL);
+    for(VkImage image : retired.images) vkDestroyImage(context.logical_device, image, NULL);
+    for(vk_allocation& allocation : retired.allocations) vk_allocator_free(context.allocator, allocation);
+}
+
+static bool lifetimes_overlap(const vk_rg_physical_image& a, const vk_rg_physical_image& b)
+{
+    return a.first_pass <= b.last_pass && b.first_pass <= a.last_pass;
+}
+
+// Creates graph.physical's images, packs them into slots and binds them
+static int create_physical(vk_context& context, vk_render_graph& graph)
+{
+    std::vector<VkMemoryRequirements> requirements(graph.physical.size());
+
+    for(uint32_t i = 0; i < graph.physical.size(); i++)
+    {
+        vk_rg_physical_image& physical = graph.physical[i];
+
+        VkImageCreateInfo image_info{};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = physical.format;
+        image_info.extent = { physical.extent.width, physical.extent.height, 1 };
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = physical.samples;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = physical.usage;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if(vkCreateImage(context.logical_device, &image_info, NULL, &physical.image) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to create transient image" << std::endl;
+            return -1;
+        }
+
+        vkGetImageMemoryRequirements(context.logical_device, physical.image, &requirements[i]);
+
+        // Attachments that never leave their pass get lazily allocated memory of their own when the device has it
+        physical.lazy = (physical.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) &&
+                        vk_allocator_find_memory_type(context.allocator, requirements[i].memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) >= 0;
+        if(physical.lazy)
+        {
+            graph.lazy_bytes += requirements[i].size;
+        }
+        else
+        {
+            graph.unaliased_bytes += requirements[i].size;
+        }
+    }
+
+    // Largest first so the big images pick the slots and the small ones fill in around them
+    std::vector<uint32_t> order(graph.physical.size());
+    for(uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+
+    for(uint32_t index : order)
+    {
+        vk_rg_physical_image& physical = graph.physical[index];
+        physical.slot = VK_RENDER_GRAPH_NONE;
+
+        for(uint32_t s = 0; s < graph.slots.size() && physical.slot == VK_RENDER_GRAPH_NONE && !physical.lazy; s++)
+        {
+            vk_rg_slot& slot = graph.slots[s];
+            if(slot.lazy || (slot.requirements.memoryTypeBits & requirements[index].memoryTypeBits) == 0) continue;
+
+            bool overlaps = false;
+            for(uint32_t occupant : slot.occupants)
+            {
+                overlaps |= lifetimes_overlap(graph.physical[occupant], physical);
+            }
+            if(overlaps) continue;
+
+            slot.requirements.size = std::max(slot.requirements.size, requirements[index].size);
+            slot.requirements.alignment = std::max(slot.requirements.alignment, requirements[index].alignment);
+            slot.requirements.memoryTypeBits &= requirements[index].memoryTypeBits;
+            slot.occupants.push_back(index);
+            physical.slot = s;
+        }
+
+        if(physical.slot == VK_RENDER_GRAPH_NONE)
+        {
+            vk_rg_slot slot{};
+            slot.requirements = requirements[index];
+            slot.lazy = physical.lazy;
+            slot.occupants.push_back(index);
+            physical.slot = graph.slots.size();
+            graph.slots.push_back(slot);
+        }
+    }
+
+    for(vk_rg_slot& slot : graph.slots)
+    {
+        std::sort(slot.occupants.begin(), slot.occupants.end(), [&](uint32_t a, uint32_t b) { return graph.physical[a].first_pass < graph.physical[b].first_pass; });
+
+        VkMemoryPropertyFlags properties = slot.lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        if(vk_allocator_alloc(context.allocator, slot.requirements, properties, 0, &slot.allocation) < 0)
+        {
+            std::cerr << "Failed to allocate transient image memory" << std::endl;
+            return -1;
+        }
+        if(!slot.lazy) graph.transient_bytes += slot.requirements.size;
+    }
+
+    for(vk_rg_physical_image& physical : graph.physical)
+    {
+        const vk_allocation& allocation = graph.slots[physical.slot].allocation;
+        if(vkBindImageMemory(context.logical_device, physical.image, allocation.memory, allocation.offset) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to bind transient image memory" << std::endl;
+            return -1;
+        }
+
+        VkImageViewCreateInfo view_info{};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = physical.image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = physical.format;
+        view_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        view_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        view_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        view_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        view_info.subresourceRange.aspectMask = vk_format_aspect(physical.format);
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+
+        if(vkCreateImageView(context.logical_device, &view_info, NULL, &physical.view) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to create transient image view" << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Assigns every used transient a physical image, keeping last frame's when nothing about them changed
+static int assign_physical(vk_context& context, vk_render_graph& graph, uint64_t serial)
+{
+    std::vector<vk_rg_physical_image> wanted;
+    for(vk_rg_image& image : graph.images)
+    {
+        if(image.imported || image.first_pass == VK_RENDER_GRAPH_NONE) continue;
+
+        vk_rg_physical_image physical{};
+        physical.format = image.format;
+        physical.extent = image.extent;
+        physical.samples = image.samples;
+        physical.usage = image.usage;
+        physical.first_pass = image.first_pass;
+        physical.last_pass = image.last_pass;
+        physical.slot = VK_RENDER_GRAPH_NONE;
+        image.physical = wanted.size();
+        wanted.push_back(physical);
+    }
+
+    bool same = wanted.size() == graph.physical.size();
+    for(uint32_t i = 0; same && i < wanted.size(); i++)
+    {
+        const vk_rg_physical_image& a = wanted[i];
+        const vk_rg_physical_image& b = graph.physical[i];
+        same = a.format == b.format && a.extent.width == b.extent.width && a.extent.height == b.extent.height &&
+               a.samples == b.samples && a.usage == b.usage && a.first_pass == b.first_pass && a.last_pass == b.last_pass;
+    }
+
+    if(!same)
+    {
+        retire_physical(graph, serial);
+        graph.physical = wanted;
+
+        if(create_physical(context, graph) < 0)
+        {
+            // Never used by the GPU, released by the next collect
+            retire_physical(graph, 0);
+            return -1;
+        }
+    }
+
+    for(vk_rg_image& image : graph.images)
+    {
+        if(image.imported || image.physical == VK_RENDER_GRAPH_NONE) continue;
+
+        image.image = graph.physical[image.physical].image;
+        image.view = graph.physical[image.physical].view;
+    }
+
+    return 0;
+}
+
+static VkImageMemoryBarrier2 image_barrier(const vk_rg_image& image, VkPipelineStageFlags2 src_stages, VkAccessFlags2 src_access,
+                                           VkPipelineStageFlags2 dst_stages, VkAccessFlags2 dst_access, VkImageLayout old_layout, VkImageLayout new_layout)
+{
+    VkImageMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src_stages;
+    barrier.srcAccessMask = src_access;
+    barrier.dstStageMask = dst_stages;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.image;
+    barrier.subresourceRange.aspectMask = image.aspect;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    return barrier;
+}
+
+// Works out what has to happen before use given the resource's state, updates the state and returns whether a
+// barrier is needed (with its src / dst filled in)
+static bool resolve_use(rg_state& state, const vk_rg_use& use, VkPipelineStageFlags2* src_stages, VkAccessFlags2* src_access)
+{
+    VkAccessFlags2 write = use.access & WRITE_ACCESS;
+    bool transition = use.image && use.layout != state.layout;
+
+    if(transition || write)
+    {
+        // Layout changes and writes wait for everything that touched the resource since the last barrier
+        *src_stages = state.write_stages | state.read_stages;
+        *src_access = state.write_access;
+        bool needed = transition || *src_stages != 0;
+
+        state.layout = use.layout;
+        state.write_stages = use.stages;
+        state.write_access = write;
+        state.read_stages = 0;
+        state.visible.clear();
+        state.visible.push_back(rg_visibility{ use.stages, use.access });
+        return needed;
+    }
+
+    state.read_stages |= use.stages;
+
+    // Read after read, or nothing to wait for
+    if(state.write_stages == 0) return false;
+    for(const rg_visibility& visible : state.visible)
+    {
+        if((use.stages & ~visible.stages) == 0 && (use.access & ~visible.access) == 0) return false;
+    }
+
+    *src_stages = state.write_stages;
+    *src_access = state.write_access;
+    state.visible.push_back(rg_visibility{ use.stages, use.access });
+    return true;
+}
+
+void vk_render_graph_begin(vk_render_graph& graph)
+{
+    graph.images.clear();
+    graph.buffers.clear();
+    graph.passes.clear();
+    graph.final_barriers.clear();
+    graph.invalid = 0;
+}
+
+uint32_t vk_render_graph_import_image(vk_render_graph& graph, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+                                      VkImageLayout initial_layout, VkPipelineStageFlags2 initial_stages, VkImageLayout final_layout)
+{
+    vk_rg_image resource{};
+    resource.image = image;
+    resource.view = view;
+    resource.format = format;
+    resource.extent = extent;
+    resource.samples = VK_SAMPLE_COUNT_1_BIT;
+    resource.aspect = vk_format_aspect(format);
+    resource.imported = 1;
+    resource.initial_layout = initial_layout;
+    resource.initial_stages = initial_stages;
+    resource.final_layout = final_layout;
+
+    graph.images.push_back(resource);
+    return graph.images.size() - 1;
+}
+
+uint32_t vk_render_graph_import_buffer(vk_render_graph& graph, VkBuffer buffer, VkPipelineStageFlags2 initial_stages, VkAccessFlags2 initial_access)
+{
+    graph.buffers.push_back(vk_rg_buffer{ buffer, initial_stages, initial_access });
+    return graph.buffers.size() - 1;
+}
+
+uint32_t vk_render_graph_create_image(vk_render_graph& graph, VkFormat format, VkExtent2D extent, VkSampleCountFlagBits samples)
+{
+    vk_rg_image resource{};
+    resource.format = format;
+    resource.extent = extent;
+    resource.samples = samples;
+    resource.aspect = vk_format_aspect(format);
+    resource.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    graph.images.push_back(resource);
+    return graph.images.size() - 1;
+}
+
+uint32_t vk_render_graph_add_pass(vk_render_graph& graph, const char* name, VkRenderingFlags rendering_flags, const vk_render_graph_record_fn& record)
+{
+    vk_rg_pass pass{};
+    pass.name = name;
+    pass.record = record;
+    pass.rendering_flags = rendering_flags;
+    pass.depth_attachment.image = VK_RENDER_GRAPH_NONE;
+    pass.depth_attachment.resolve_image = VK_RENDER_GRAPH_NONE;
+
+    graph.passes.push_back(pass);
+    return graph.passes.size() - 1;
+}
+
+void vk_render_graph_color_attachment(vk_render_graph& graph, uint32_t pass, uint32_t image, VkAttachmentLoadOp load_op, VkAttachmentStoreOp store_op, VkClearColorValue clear)
+{
+    if(!valid_pass(graph, pass)) return;
+
+    VkAccessFlags2 access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+    if(load_op == VK_ATTACHMENT_LOAD_OP_LOAD) access |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+    add_use(graph, pass, image, 1, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, access, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+    vk_rg_attachment attachment{};
+    attachment.image = image;
+    attachment.resolve_image = VK_RENDER_GRAPH_NONE;
+    attachment.load_op = load_op;
+    attachment.store_op = store_op;
+    attachment.clear.color = clear;
+    graph.passes[pass].color_attachments.push_back(attachment);
+}
+
+void vk_render_graph_resolve_attachment(vk_render_graph& graph, uint32_t pass, uint32_t image, uint32_t resolve_image)
+{
+    if(!valid_pass(graph, pass)) return;
+
+    for(vk_rg_attachment& attachment : graph.passes[pass].color_attachments)
+    {
+        if(attachment.image != image) continue;
+
+        // Resolves write in the color output stage at the end of the rendering scope
+        add_use(graph, pass, resolve_image, 1, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        attachment.resolve_image = resolve_image;
+        return;
+    }
+
+    std::cerr << "Render graph pass " << graph.passes[pass].name << " resolves an image that is not one of its color attachments" << std::endl;
+    graph.invalid = 1;
+}
+
+void vk_render_graph_depth_attachment(vk_render_graph& graph, uint32_t pass, uint32_t image, VkAttachmentLoadOp load_op, VkAttachmentStoreOp store_op, float clear_depth, uint8_t write)
+{
+    if(!valid_pass(graph, pass)) return;
+    if(image >= graph.images.size())
+    {
+        std::cerr << "Render graph pass " << graph.passes[pass].name << " uses an unknown depth image" << std::endl;
+        graph.invalid = 1;
+        return;
+    }
+
+    // Clears are writes even in a read only pass, so they need the writable layout
+    VkAccessFlags2 access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    if(write || load_op == VK_ATTACHMENT_LOAD_OP_CLEAR) access |= VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    bool writable = access & VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // The synchronization2 layouts cover depth only and combined formats alike (the depth only layouts would need
+    // separateDepthStencilLayouts), combined formats are bound as the stencil attachment too and transition both aspects
+    VkImageLayout layout = writable ? VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+    add_use(graph, pass, image, 1, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, access, layout);
+
+    vk_rg_attachment attachment{};
+    attachment.image = image;
+    attachment.resolve_image = VK_RENDER_GRAPH_NONE;
+    attachment.load_op = load_op;
+    attachment.store_op = store_op;
+    attachment.clear.depthStencil.depth = clear_depth;
+    attachment.clear.depthStencil.stencil = 0;
+    graph.passes[pass].depth_attachment = attachment;
+}
+
+void vk_render_graph_use_image(vk_render_graph& graph, uint32_t pass, uint32_t image, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout)
+{
+    add_use(graph, pass, image, 1, stages, access, layout);
+}
+
+void vk_render_graph_use_buffer(vk_render_graph& graph, uint32_t pass, uint32_t buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access)
+{
+    add_use(graph, pass, buffer, 0, stages, access, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+int vk_render_graph_compile(vk_context& context, vk_render_graph& graph, uint64_t serial)
+{
+    VK_CPU_ZONE("vk_render_graph_compile");
+
+    if(graph.invalid)
+    {
+        std::cerr << "Failed to compile render graph with invalid declarations" << std::endl;
+        return -1;
+    }
+
+    for(vk_rg_image& image : graph.images)
+    {
+        image.first_pass = VK_RENDER_GRAPH_NONE;
+        image.last_pass = VK_RENDER_GRAPH_NONE;
+        image.usage = 0;
+        image.used_stages = 0;
+        image.written_access = 0;
+        image.physical = VK_RENDER_GRAPH_NONE;
+    }
+
+    for(uint32_t p = 0; p < graph.passes.size(); p++)
+    {
+        for(const vk_rg_use& use : graph.passes[p].uses)
+        {
+            if(!use.image) continue;
+
+            vk_rg_image& image = graph.images[use.resource];
+            if(image.first_pass == VK_RENDER_GRAPH_NONE) image.first_pass = p;
+            image.last_pass = p;
+            image.usage |= usage_for_access(use.access, use.layout);
+            image.used_stages |= use.stages;
+            image.written_access |= use.access & WRITE_ACCESS;
+        }
+    }
+
+    // A transient living in a single pass purely as an attachment that is neither loaded nor stored never needs memory
+    // outside the tile, it can be a transient attachment
+    for(uint32_t i = 0; i < graph.images.size(); i++)
+    {
+        vk_rg_image& image = graph.images[i];
+        if(image.imported || image.first_pass == VK_RENDER_GRAPH_NONE || image.first_pass != image.last_pass || (image.usage & ~ATTACHMENT_USAGE) != 0) continue;
+
+        const vk_rg_pass& pass = graph.passes[image.first_pass];
+        bool discarded = true;
+        for(const vk_rg_attachment& attachment : pass.color_attachments)
+        {
+            if(attachment.resolve_image == i) discarded = false;
+            if(attachment.image == i && (attachment.load_op == VK_ATTACHMENT_LOAD_OP_LOAD || attachment.store_op == VK_ATTACHMENT_STORE_OP_STORE)) discarded = false;
+        }
+        if(pass.depth_attachment.image == i && (pass.depth_attachment.load_op == VK_ATTACHMENT_LOAD_OP_LOAD || pass.depth_attachment.store_op == VK_ATTACHMENT_STORE_OP_STORE)) discarded = false;
+
+        if(discarded) image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    }
+
+    if(assign_physical(context, graph, serial) < 0)
+    {
+        return -1;
+    }
+
+    std::vector<rg_state> image_states(graph.images.size());
+    for(uint32_t i = 0; i < graph.images.size(); i++)
+    {
+        const vk_rg_image& image = graph.images[i];
+        rg_state& state = image_states[i];
+        state.read_stages = 0;
+
+        if(image.imported)
+        {
+            state.layout = image.initial_layout;
+            state.write_stages = image.initial_stages;
+            state.write_access = 0;
+            continue;
+        }
+
+        // An aliased image first waits on whoever used the memory before it, the first occupant on the last one
+        // (its previous frame when the image has the slot to itself)
+        state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        state.write_stages = 0;
+        state.write_access = 0;
+        if(image.physical == VK_RENDER_GRAPH_NONE) continue;
+
+        const vk_rg_slot& slot = graph.slots[graph.physical[image.physical].slot];
+        uint32_t previous = slot.occupants.back();
+        for(uint32_t o = 1; o < slot.occupants.size(); o++)
+        {
+            if(slot.occupants[o] == image.physical) previous = slot.occupants[o - 1];
+        }
+
+        for(const vk_rg_image& other : graph.images)
+        {
+            if(!other.imported && other.physical == previous)
+            {
+                state.write_stages = other.used_stages;
+                state.write_access = other.written_access;
+            }
+        }
+    }
+
+    std::vector<rg_state> buffer_states(graph.buffers.size());
+    for(uint32_t i = 0; i < graph.buffers.size(); i++)
+    {
+        const vk_rg_buffer& buffer = graph.buffers[i];
+        rg_state& state = buffer_states[i];
+        state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        state.write_access = buffer.initial_access & WRITE_ACCESS;
+        state.write_stages = state.write_access ? buffer.initial_stages : 0;
+        state.read_stages = state.write_access ? 0 : buffer.initial_stages;
+    }
+
+    for(vk_rg_pass& pass : graph.passes)
+    {
+        pass.image_barriers.clear();
+        pass.buffer_barriers.clear();
+
+        for(const vk_rg_use& use : pass.uses)
+        {
+            VkPipelineStageFlags2 src_stages = 0;
+            VkAccessFlags2 src_access = 0;
+
+            if(use.image)
+            {
+                rg_state& state = image_states[use.resource];
+                VkImageLayout old_layout = state.layout;
+                if(resolve_use(state, use, &src_stages, &src_access))
+                {
+                    pass.image_barriers.push_back(image_barrier(graph.images[use.resource], src_stages, src_access, use.stages, use.access, old_layout, use.layout));
+                }
+            }
+            else if(resolve_use(buffer_states[use.resource], use, &src_stages, &src_access))
+            {
+                VkBufferMemoryBarrier2 barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+                barrier.srcStageMask = src_stages;
+                barrier.srcAccessMask = src_access;
+                barrier.dstStageMask = use.stages;
+                barrier.dstAccessMask = use.access;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer = graph.buffers[use.resource].buffer;
+                barrier.offset = 0;
+                barrier.size = VK_WHOLE_SIZE;
+                pass.buffer_barriers.push_back(barrier);
+            }
+        }
+    }
+
+    // Imported images leave in the layout the next user (e.g. present) expects, the semaphore signal after the frame
+    // covers the rest
+    graph.final_barriers.clear();
+    for(uint32_t i = 0; i < graph.images.size(); i++)
+    {
+        const vk_rg_image& image = graph.images[i];
+        const rg_state& state = image_states[i];
+        if(!image.imported || image.final_layout == VK_IMAGE_LAYOUT_UNDEFINED || image.final_layout == state.layout) continue;
+
+        graph.final_barriers.push_back(image_barrier(image, state.write_stages | state.read_stages, state.write_access,
+                                                     VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, state.layout, image.final_layout));
+    }
+
+    return 0;
+}
+
+static void record_barriers(VkCommandBuffer cmd, const std::vector<VkImageMemoryBarrier2>& image_barriers, const std::vector<VkBufferMemoryBarrier2>& buffer_barriers)
+{
+    if(image_barriers.empty() && buffer_barriers.empty()) return;
+
+    VkDependencyInfo dependency{};
+    dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency.imageMemoryBarrierCount = image_barriers.size();
+    dependency.pImageMemoryBarriers = image_barriers.data();
+    dependency.bufferMemoryBarrierCount = buffer_barriers.size();
+    dependency.pBufferMemoryBarriers = buffer_barriers.data();
+    vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+static VkRenderingAttachmentInfo rendering_attachment(const vk_render_graph& graph, const vk_rg_pass& pass, const vk_rg_attachment& attachment)
+{
+    VkRenderingAttachmentInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    info.imageView = graph.images[attachment.image].view;
+    info.loadOp = attachment.load_op;
+    info.storeOp = attachment.store_op;
+    info.clearValue = attachment.clear;
+
+    if(attachment.resolve_image != VK_RENDER_GRAPH_NONE)
+    {
+        info.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+        info.resolveImageView = graph.images[attachment.resolve_image].view;
+        info.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+
+    for(const vk_rg_use& use : pass.uses)
+    {
+        if(use.image && use.resource == attachment.image) info.imageLayout = use.layout;
+    }
+
+    return info;
+}
+
+void vk_render_graph_execute(vk_render_graph& graph, VkCommandBuffer cmd)
+{
+    VK_CPU_ZONE("vk_render_graph_execute");
+
+    for(const vk_rg_pass& pass : graph.passes)
+    {
+        uint32_t region = graph.profiler != NULL ? vk_gpu_profiler_begin(*graph.profiler, cmd, pass.name) : VK_GPU_PROFILER_NONE;
+
+        record_barriers(cmd, pass.image_barriers, pass.buffer_barriers);
+
+        bool has_depth = pass.depth_attachment.image != VK_RENDER_GRAPH_NONE;
+        if(pass.color_attachments.empty() && !has_depth)
+        {
+            if(pass.record) pass.record(cmd);
+            if(graph.profiler != NULL) vk_gpu_profiler_end(*graph.profiler, cmd, region);
+            continue;
+        }
+
+        VkRenderingAttachmentInfo color_attachments[8];
+        uint32_t color_count = std::min<uint32_t>(pass.color_attachments.size(), 8);
+        for(uint32_t i = 0; i < color_count; i++)
+        {
+            color_attachments[i] = rendering_attachment(graph, pass, pass.color_attachments[i]);
+        }
+
+        VkRenderingAttachmentInfo depth_attachment{};
+        if(has_depth)
+        {
+            depth_attachment = rendering_attachment(graph, pass, pass.depth_attachment);
+        }
+
+        // Attachments of a pass are expected to share an extent
+        uint32_t first = color_count > 0 ? pass.color_attachments[0].image : pass.depth_attachment.image;
+
+        VkRenderingInfo rendering_info{};
+        rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        rendering_info.flags = pass.rendering_flags;
+        rendering_info.renderArea = VkRect2D{ VkOffset2D{}, graph.images[first].extent };
+        rendering_info.layerCount = 1;
+        rendering_info.colorAttachmentCount = color_count;
+        rendering_info.pColorAttachments = color_attachments;
+        rendering_info.pDepthAttachment = has_depth && (graph.images[pass.depth_attachment.image].aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? &depth_attachment : NULL;
+        rendering_info.pStencilAttachment = has_depth && (graph.images[pass.depth_attachment.image].aspect & VK_IMAGE_ASPECT_STENCIL_BIT) ? &depth_attachment : NULL;
+
+        vkCmdBeginRendering(cmd, &rendering_info);
+        if(pass.record) pass.record(cmd);
+        vkCmdEndRendering(cmd);
+
+        if(graph.profiler != NULL) vk_gpu_profiler_end(*graph.profiler, cmd, region);
+    }
+
+    record_barriers(cmd, graph.final_barriers, std::vector<VkBufferMemoryBarrier2>());
+}
+
+VkImage vk_render_graph_get_image(const vk_render_graph& graph, uint32_t image)
+{
+    return image < graph.images.size() ? graph.images[image].image : VK_NULL_HANDLE;
+}
+
+VkImageView vk_render_graph_get_view(const vk_render_graph& graph, uint32_t image)
+{
+    return image < graph.images.size() ? graph.images[image].view : VK_NULL_HANDLE;
+}
+
+void vk_render_graph_collect(vk_context& context, vk_render_graph& graph, uint64_t completed_serial)
+{
+    for(size_t i = 0; i < graph.retired.size();)
+    {
+        if(graph.retired[i].serial <= completed_serial)
+        {
+            destroy_retired(context, graph.retired[i]);
+            graph.retired[i] = graph.retired.back();
+            graph.retired.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void vk_render_graph_destroy(vk_context& context, vk_render_graph& graph)
+{
+    retire_physical(graph, 0);
+    for(vk_rg_retired& retired : graph.retired)
+    {
+        destroy_retired(context, retired);
+    }
+
+    graph.retired.clear();
+    graph.images.clear();
+    graph.buffers.clear();
+    graph.passes.clear();
+    graph.final_barriers.clear();
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include "vk_allocator.h"
+#include "vk_gpu_profiler.h"
+
+struct vk_context;
+
+// Frame render graph
+// Every frame the graph is rebuilt: images / buffers are imported (swapchain images, long lived buffers) or declared
+// transient, passes declare what they read and write, and vk_render_graph_compile works out
+// - one batched vkCmdPipelineBarrier2 per pass covering only the hazards that actually exist (read after read in an
+//   already visible stage needs nothing, layout changes and writes wait on exactly the stages that touched the resource)
+// - the layout transitions, including the final one of imported images (e.g. to PRESENT_SRC_KHR)
+// - physical images for transient resources. Transients whose pass ranges don't overlap share memory; the first pass
+//   using an aliased image waits on the previous occupant's stages and discards its contents (UNDEFINED layout).
+//   Transients only used as attachments of a single pass that neither load nor store them (depth, MSAA color resolved
+//   inside the pass, G-buffer targets consumed as input attachments) become VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT
+//   images in lazily allocated memory when the device has it, and join the aliased memory otherwise.
+// Passes run in the order they were added. Physical transients are kept as long as the frame keeps declaring the same
+// transients with the same lifetimes, when that changes (e.g. a resize) the old ones are retired by serial.
+
+typedef std::function<void(VkCommandBuffer cmd)> vk_render_graph_record_fn;
+
+#define VK_RENDER_GRAPH_NONE UINT32_MAX
+
+struct vk_rg_image
+{
+    VkImage image;
+    VkImageView view;
+    VkFormat format;
+    VkExtent2D extent;
+    VkSampleCountFlagBits samples;
+    VkImageAspectFlags aspect;
+    uint8_t imported;
+    VkImageLayout initial_layout;           // Imported only
+    VkPipelineStageFlags2 initial_stages;   // Stages the image's previous use / semaphore wait happened in
+    VkImageLayout final_layout;             // VK_IMAGE_LAYOUT_UNDEFINED leaves the image in its last layout
+    // Filled in by vk_render_graph_compile
+    uint32_t first_pass;
+    uint32_t last_pass;
+    VkImageUsageFlags usage;
+    VkPipelineStageFlags2 used_stages;
+    VkAccessFlags2 written_access;
+    uint32_t physical;
+};
+
+struct vk_rg_buffer
+{
+    VkBuffer buffer;
+    VkPipelineStageFlags2 initial_stages;
+    VkAccessFlags2 initial_access;
+};
+
+struct vk_rg_use
+{
+    uint32_t resource;
+    uint8_t image;
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout;
+};
+
+struct vk_rg_attachment
+{
+    uint32_t image;
+    uint32_t resolve_image;     // Multisampled color is averaged into it at the end of the pass, VK_RENDER_GRAPH_NONE for none
+    VkAttachmentLoadOp load_op;
+    VkAttachmentStoreOp store_op;
+    VkClearValue clear;
+};
+
+struct vk_rg_pass
+{
+    std::string name;
+    vk_render_graph_record_fn record;
+    VkRenderingFlags rendering_flags;
+    std::vector<vk_rg_use> uses;
+    std::vector<vk_rg_attachment> color_attachments;
+    vk_rg_attachment depth_attachment;      // image is VK_RENDER_GRAPH_NONE without one
+    std::vector<VkImageMemoryBarrier2> image_barriers;
+    std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+};
+
+// A transient image as the compiled graph created it, reused while the declarations stay the same
+struct vk_rg_physical_image
+{
+    VkFormat format;
+    VkExtent2D extent;
+    VkSampleCountFlagBits samples;
+    VkImageUsageFlags usage;
+    uint32_t first_pass;
+    uint32_t last_pass;
+    VkImage image;
+    VkImageView view;
+    uint32_t slot;
+    uint8_t lazy;
+};
+
+// Memory shared by physical images with disjoint lifetimes
+struct vk_rg_slot
+{
+    vk_allocation allocation;
+    VkMemoryRequirements requirements;
+    uint8_t lazy;                       // Lazily allocated memory, never shared
+    std::vector<uint32_t> occupants;    // Physical images ordered by first pass
+};
+
+struct vk_rg_retired
+{
+    std::vector<VkImage> images;
+    std::vector<VkImageView> views;
+    std::vector<vk_allocation> allocations;
+    uint64_t serial;
+};
+
+struct vk_render_graph
+{
+    std::vector<vk_rg_image> images;
+    std::vector<vk_rg_buffer> buffers;
+    std::vector<vk_rg_pass> passes;
+    std::vector<VkImageMemoryBarrier2> final_barriers;
+    std::vector<vk_rg_physical_image> physical;
+    std::vector<vk_rg_slot> slots;
+    std::vector<vk_rg_retired> retired;
+    uint8_t invalid;                    // A declaration failed, compile reports it
+    VkDeviceSize transient_bytes;       // Memory backing the transients
+    VkDeviceSize unaliased_bytes;       // What the transients would take without aliasing
+    VkDeviceSize lazy_bytes;            // Transient attachments in lazily allocated memory, only committed if the driver has to
+    vk_gpu_profiler* profiler;          // Every pass (barriers included) becomes a GPU region named after it when set
+};
+
+// Starts declaring a new frame, physical transients of the previous frame are kept for reuse
+void vk_render_graph_begin(vk_render_graph& graph);
+
+uint32_t vk_render_graph_import_image(vk_render_graph& graph, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+                                      VkImageLayout initial_layout, VkPipelineStageFlags2 initial_stages, VkImageLayout final_layout);
+uint32_t vk_render_graph_import_buffer(vk_render_graph& graph, VkBuffer buffer, VkPipelineStageFlags2 initial_stages, VkAccessFlags2 initial_access);
+
+// Transient image only valid within the frame, created / aliased by vk_render_graph_compile
+uint32_t vk_render_graph_create_image(vk_render_graph& graph, VkFormat format, VkExtent2D extent, VkSampleCountFlagBits samples);
+
+// rendering_flags are passed to vkCmdBeginRendering when the pass has attachments (e.g. VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT)
+uint32_t vk_render_graph_add_pass(vk_render_graph& graph, const char* name, VkRenderingFlags rendering_flags, const vk_render_graph_record_fn& record);
+
+void vk_render_graph_color_attachment(vk_render_graph& graph, uint32_t pass, uint32_t image, VkAttachmentLoadOp load_op, VkAttachmentStoreOp store_op, VkClearColorValue clear);
+
+// Averages image (a multisampled color attachment of pass) into resolve_image at the end of the pass
+void vk_render_graph_resolve_attachment(vk_render_graph& graph, uint32_t pass, uint32_t image, uint32_t resolve_image);
+
+// write == 0 makes it a read only depth attachment (depth test without depth writes)
+// Formats with a stencil aspect are bound as the stencil attachment as well, cleared to 0
+void vk_render_graph_depth_attachment(vk_render_graph& graph, uint32_t pass, uint32_t image, VkAttachmentLoadOp load_op, VkAttachmentStoreOp store_op, float clear_depth, uint8_t write);
+
+// Any other image access, e.g. sampling (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+void vk_render_graph_use_image(vk_render_graph& graph, uint32_t pass, uint32_t image, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout);
+void vk_render_graph_use_buffer(vk_render_graph& graph, uint32_t pass, uint32_t buffer, VkPipelineStageFlags2 stages, VkAccessFlags2 access);
+
+// Creates / reuses the physical transients and computes every barrier
+// serial identifies the submission the graph is executed in, replaced transients are retired with it
+// 0 - success
+// -1 - failure
+int vk_render_graph_compile(vk_context& context, vk_render_graph& graph, uint64_t serial);
+
+// Records barriers, dynamic rendering scopes and the passes' record callbacks into cmd
+void vk_render_graph_execute(vk_render_graph& graph, VkCommandBuffer cmd);
+
+VkImage vk_render_graph_get_image(const vk_render_graph& graph, uint32_t image);
+VkImageView vk_render_graph_get_view(const vk_render_graph& graph, uint32_t image);
+
+// Destroys retired transients whose last frame (serial <= completed_serial) has finished
+void vk_render_graph_collect(vk_context& context, vk_render_graph& graph, uint64_t completed_serial);
+void vk_render_graph_destroy(vk_context& context, vk_render_graph& graph);
@@ -0,0 +1,249 @@
+#include "vk_render_queue.h"
+#include "vk_bindless.h"
+#include "vk_cpu_profiler.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+// Below this many packets spreading the sort over the job system costs more than it saves
+#define PARALLEL_SORT_THRESHOLD 16384
+
+uint64_t vk_sort_key(uint8_t pass, uint16_t pipeline, uint16_t material, float depth)
+{
+    if(depth < 0.0f) depth = 0.0f;
+    if(depth > 1.0f) depth = 1.0f;
+    uint64_t quantized_depth = (uint64_t)(depth * 0xFFFFFF);
+
+    return ((uint64_t)pass << 56) | ((uint64_t)pipeline << 40) | ((uint64_t)material << 24) | quantized_depth;
+}
+
+uint16_t vk_render_queue_pipeline_id(vk_render_queue& queue, VkPipeline pipeline)
+{
+    auto found = queue.pipeline_ids.find(pipeline);
+    if(found != queue.pipeline_ids.end()) return found->second;
+
+    if(queue.pipeline_ids.size() >= VK_RENDER_QUEUE_SHARED_PIPELINE_ID)
+    {
+        if(!queue.pipeline_ids_exhausted)
+        {
+            std::cerr << "Render queue ran out of pipeline ids, further pipelines share one sort id" << std::endl;
+            queue.pipeline_ids_exhausted = 1;
+        }
+        return VK_RENDER_QUEUE_SHARED_PIPELINE_ID;
+    }
+
+    uint16_t id = (uint16_t)queue.pipeline_ids.size();
+    queue.pipeline_ids.emplace(pipeline, id);
+    return id;
+}
+
+void vk_render_queue_begin(vk_render_queue& queue)
+{
+    queue.packets.clear();
+    queue.order.clear();
+    queue.instance_buffer = VK_NULL_HANDLE;
+    queue.instance_offset = 0;
+}
+
+void vk_render_queue_set_pass(vk_render_queue& queue, uint8_t pass, const VkViewport& viewport, const VkRect2D& scissor)
+{
+    queue.passes[pass].viewport = viewport;
+    queue.passes[pass].scissor = scissor;
+}
+
+void vk_render_queue_set_instances(vk_render_queue& queue, VkBuffer buffer, VkDeviceSize offset)
+{
+    queue.instance_buffer = buffer;
+    queue.instance_offset = offset;
+}
+
+void vk_render_queue_submit(vk_render_queue& queue, uint64_t key, VkPipeline pipeline, const vk_mesh_pool& pool, const vk_mesh& mesh,
+                            uint32_t instance_count, uint32_t first_instance, const void* push, uint32_t push_size)
+{
+    vk_draw_packet packet;
+    packet.key = key;
+    packet.pipeline = pipeline;
+    packet.pool = &pool;
+    packet.mesh = mesh;
+    packet.instance_count = instance_count;
+    packet.first_instance = first_instance;
+    packet.push_size = push_size < VK_RENDER_QUEUE_PUSH_SIZE ? push_size : VK_RENDER_QUEUE_PUSH_SIZE;
+    if(packet.push_size > 0) memcpy(packet.push, push, packet.push_size);
+
+    queue.packets.push_back(packet);
+}
+
+// Runs fn once per block, on the job system when there is more than one
+static void for_each_block(vk_job_system* jobs, uint32_t blocks, const std::function<void(uint32_t block)>& fn)
+{
+    if(blocks == 1)
+    {
+        fn(0);
+        return;
+    }
+
+    vk_job_parallel_for(*jobs, blocks, 1, [&](uint32_t begin, uint32_t end, uint32_t thread)
+    {
+        for(uint32_t block = begin; block < end; block++)
+        {
+            fn(block);
+        }
+    });
+}
+
+void vk_render_queue_sort(vk_render_queue& queue, vk_job_system* jobs)
+{
+    VK_CPU_ZONE("vk_render_queue_sort");
+
+    uint32_t count = queue.packets.size();
+
+    queue.order.resize(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        queue.order[i].key = queue.packets[i].key;
+        queue.order[i].packet = i;
+    }
+
+    if(count < 2) return;
+
+    // LSD radix sort, 8 bits per pass. Every block histograms its slice of the input, the histograms are turned into
+    // per (digit, block) output offsets and every block scatters its slice in order, which keeps the sort stable.
+    uint32_t blocks = jobs != NULL && count >= PARALLEL_SORT_THRESHOLD ? vk_job_thread_count(*jobs) : 1;
+    queue.scratch.resize(count);
+    queue.histograms.resize(blocks * RADIX_BUCKETS);
+
+    vk_sort_item* src = queue.order.data();
+    vk_sort_item* dst = queue.scratch.data();
+    uint32_t* histograms = queue.histograms.data();
+
+    for(uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        uint32_t shift = pass * RADIX_BITS;
+
+        for_each_block(jobs, blocks, [&](uint32_t block)
+        {
+            uint32_t* histogram = histograms + block * RADIX_BUCKETS;
+            memset(histogram, 0, RADIX_BUCKETS * sizeof(uint32_t));
+
+            uint32_t end = (uint64_t)count * (block + 1) / blocks;
+            for(uint32_t i = (uint64_t)count * block / blocks; i < end; i++)
+            {
+                histogram[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+            }
+        });
+
+        // Unused key bits (e.g. a single pass or no depth) leave every key with the same digit, nothing to move
+        uint32_t first_digit = (src[0].key >> shift) & (RADIX_BUCKETS - 1);
+        uint32_t first_digit_count = 0;
+        for(uint32_t block = 0; block < blocks; block++)
+        {
+            first_digit_count += histograms[block * RADIX_BUCKETS + first_digit];
+        }
+        if(first_digit_count == count) continue;
+
+        uint32_t offset = 0;
+        for(uint32_t digit = 0; digit < RADIX_BUCKETS; digit++)
+        {
+            for(uint32_t block = 0; block < blocks; block++)
+            {
+                uint32_t digit_count = histograms[block * RADIX_BUCKETS + digit];
+                histograms[block * RADIX_BUCKETS + digit] = offset;
+                offset += digit_count;
+            }
+        }
+
+        for_each_block(jobs, blocks, [&](uint32_t block)
+        {
+            uint32_t* offsets = histograms + block * RADIX_BUCKETS;
+
+            uint32_t end = (uint64_t)count * (block + 1) / blocks;
+            for(uint32_t i = (uint64_t)count * block / blocks; i < end; i++)
+            {
+                dst[offsets[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+            }
+        });
+
+        vk_sort_item* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if(src != queue.order.data())
+    {
+        queue.order.swap(queue.scratch);
+    }
+}
+
+void vk_render_queue_pass_range(const vk_render_queue& queue, uint8_t pass, uint32_t* begin, uint32_t* end)
+{
+    // The pass is the top byte of the key so every pass is one contiguous run of the sorted order
+    auto first = std::lower_bound(queue.order.begin(), queue.order.end(), pass, [](const vk_sort_item& item, uint32_t value) { return (item.key >> 56) < value; });
+    auto last = std::lower_bound(first, queue.order.end(), pass + 1, [](const vk_sort_item& item, uint32_t value) { return (item.key >> 56) < value; });
+
+    *begin = first - queue.order.begin();
+    *end = last - queue.order.begin();
+}
+
+void vk_render_queue_record(VkCommandBuffer cmd, const vk_render_queue& queue, const vk_bindless_heap& heap, uint32_t begin, uint32_t end)
+{
+    if(begin >= end) return;
+
+    // Command buffers start without any state, everything below is bound at most once until it changes
+    vk_bindless_bind(cmd, heap, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    if(queue.instance_buffer != VK_NULL_HANDLE)
+    {
+        vkCmdBindVertexBuffers(cmd, VK_MESH_INSTANCE_BINDING, 1, &queue.instance_buffer, &queue.instance_offset);
+    }
+
+    const vk_render_pass_state* bound_pass = NULL;
+    VkPipeline bound_pipeline = VK_NULL_HANDLE;
+    const vk_mesh_pool* bound_pool = NULL;
+    uint32_t pushed_size = 0;
+    uint8_t pushed[VK_RENDER_QUEUE_PUSH_SIZE];
+
+    for(uint32_t i = begin; i < end; i++)
+    {
+        const vk_draw_packet& packet = queue.packets[queue.order[i].packet];
+
+        const vk_render_pass_state* pass = &queue.passes[packet.key >> 56];
+        if(pass != bound_pass)
+        {
+            if(bound_pass == NULL || memcmp(&pass->viewport, &bound_pass->viewport, sizeof(VkViewport)) != 0)
+            {
+                vkCmdSetViewport(cmd, 0, 1, &pass->viewport);
+            }
+            if(bound_pass == NULL || memcmp(&pass->scissor, &bound_pass->scissor, sizeof(VkRect2D)) != 0)
+            {
+                vkCmdSetScissor(cmd, 0, 1, &pass->scissor);
+            }
+            bound_pass = pass;
+        }
+
+        if(packet.pipeline != bound_pipeline)
+        {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+            bound_pipeline = packet.pipeline;
+        }
+
+        if(packet.pool != bound_pool)
+        {
+            vk_mesh_pool_bind(cmd, *packet.pool);
+            bound_pool = packet.pool;
+        }
+
+        // Every pipeline shares the bindless layout so pushed constants survive pipeline changes
+        if(packet.push_size > 0 && (packet.push_size != pushed_size || memcmp(packet.push, pushed, packet.push_size) != 0))
+        {
+            vk_bindless_push(cmd, heap, packet.push, packet.push_size);
+            memcpy(pushed, packet.push, packet.push_size);
+            pushed_size = packet.push_size;
+        }
+
+        vk_mesh_draw(cmd, packet.mesh, packet.instance_count, packet.first_instance);
+    }
+}
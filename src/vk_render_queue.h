@@ -0,0 +1,89 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include "vk_mesh.h"
+#include "vk_jobs.h"
+
+struct vk_bindless_heap;
+
+// Sorted draw list
+// Submitters push compact draw packets tagged with a 64 bit sort key, the queue radix sorts them (in parallel on the job
+// system for large lists) and recording walks the sorted packets only issuing pipeline binds, mesh pool binds, push
+// constants and viewport / scissor when they differ from what the command buffer already has. The bindless heap is
+// bound once per command buffer, so with sorted keys the per draw cost is mostly the draw call itself.
+//
+// Key layout, most significant first:
+// | pass (8) | pipeline (16) | material (16) | depth (24) |
+
+#define VK_RENDER_QUEUE_PUSH_SIZE 16
+#define VK_RENDER_QUEUE_MAX_PASSES 256
+#define VK_RENDER_QUEUE_SHARED_PIPELINE_ID 0xFFFF    // Every pipeline past the first 65535 sorts under this id
+
+struct vk_draw_packet
+{
+    uint64_t key;
+    VkPipeline pipeline;
+    const vk_mesh_pool* pool;
+    vk_mesh mesh;
+    uint32_t instance_count;
+    uint32_t first_instance;
+    uint32_t push_size;     // Bytes of push used, pushed at offset 0 of the bindless layout's push range
+    uint8_t push[VK_RENDER_QUEUE_PUSH_SIZE];
+};
+
+struct vk_sort_item
+{
+    uint64_t key;
+    uint32_t packet;
+};
+
+struct vk_render_pass_state
+{
+    VkViewport viewport;
+    VkRect2D scissor;
+};
+
+struct vk_render_queue
+{
+    std::vector<vk_draw_packet> packets;
+    std::vector<vk_sort_item> order;        // Sorted by vk_render_queue_sort
+    std::vector<vk_sort_item> scratch;
+    std::vector<uint32_t> histograms;       // 256 counters per sorting block
+    vk_render_pass_state passes[VK_RENDER_QUEUE_MAX_PASSES];
+    std::unordered_map<VkPipeline, uint16_t> pipeline_ids;
+    uint8_t pipeline_ids_exhausted;         // The shared id has been handed out
+    VkBuffer instance_buffer;               // Bound on VK_MESH_INSTANCE_BINDING when set
+    VkDeviceSize instance_offset;
+};
+
+// Builds a sort key, depth is 0..1 and sorts ascending (front to back), pass 1 - depth for back to front
+uint64_t vk_sort_key(uint8_t pass, uint16_t pipeline, uint16_t material, float depth);
+
+// Small stable id for pipeline to put in sort keys, assigned on first use
+// Once the 16 bit ids run out new pipelines share VK_RENDER_QUEUE_SHARED_PIPELINE_ID: still drawn correctly (binds
+// compare the pipeline itself) but no longer grouped by the sort. Not thread safe, assign ids from one thread.
+uint16_t vk_render_queue_pipeline_id(vk_render_queue& queue, VkPipeline pipeline);
+
+// Empties the queue, call once per frame before submitting
+void vk_render_queue_begin(vk_render_queue& queue);
+
+// Viewport / scissor set while recording packets of pass
+void vk_render_queue_set_pass(vk_render_queue& queue, uint8_t pass, const VkViewport& viewport, const VkRect2D& scissor);
+
+// Per instance stream every packet's instances are read from (see vk_instancing.h), VK_NULL_HANDLE for none
+void vk_render_queue_set_instances(vk_render_queue& queue, VkBuffer buffer, VkDeviceSize offset);
+
+// push_size must be <= VK_RENDER_QUEUE_PUSH_SIZE
+void vk_render_queue_submit(vk_render_queue& queue, uint64_t key, VkPipeline pipeline, const vk_mesh_pool& pool, const vk_mesh& mesh,
+                            uint32_t instance_count, uint32_t first_instance, const void* push, uint32_t push_size);
+
+// Sorts the packets by key, jobs may be NULL to sort on the calling thread
+// Must not be called from inside a job
+void vk_render_queue_sort(vk_render_queue& queue, vk_job_system* jobs);
+
+// Range of the sorted packets belonging to pass, for recording passes into separate rendering scopes
+void vk_render_queue_pass_range(const vk_render_queue& queue, uint8_t pass, uint32_t* begin, uint32_t* end);
+
+// Records sorted packets [begin, end) into cmd, safe to call for disjoint ranges from several threads
+void vk_render_queue_record(VkCommandBuffer cmd, const vk_render_queue& queue, const vk_bindless_heap& heap, uint32_t begin, uint32_t end);
@@ -0,0 +1,179 @@
+#include "vk_shader_pack.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static int map_file(const std::string& path, vk_shader_pack* pack)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) return -1;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return -1;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL)
+    {
+        CloseHandle(file);
+        return -1;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return -1;
+    }
+
+    pack->data = (const uint8_t*)data;
+    pack->size = (size_t)size.QuadPart;
+    pack->file = file;
+    pack->mapping = mapping;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) return -1;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);     // The mapping keeps the file alive
+    if(data == MAP_FAILED) return -1;
+
+    pack->data = (const uint8_t*)data;
+    pack->size = st.st_size;
+    pack->file = NULL;
+    pack->mapping = NULL;
+#endif
+    return 0;
+}
+
+int vk_shader_pack_open(const std::string& path, vk_shader_pack* pack)
+{
+    if(pack == NULL) return -1;
+
+    *pack = vk_shader_pack{};
+    if(map_file(path, pack) < 0)
+    {
+        std::cerr << "Failed to open shader pack " << path << std::endl;
+        return -1;
+    }
+
+    // Validate everything the lookups rely on up front so finds never have to bounds check
+    const vk_shader_pack_header* header = (const vk_shader_pack_header*)pack->data;
+    uint8_t valid = pack->size >= sizeof(vk_shader_pack_header) &&
+                    header->magic == VK_SHADER_PACK_MAGIC &&
+                    header->version == VK_SHADER_PACK_VERSION &&
+                    sizeof(vk_shader_pack_header) + (uint64_t)header->entry_count * sizeof(vk_shader_pack_entry) <= pack->size &&
+                    header->names_offset <= pack->size && header->names_size <= pack->size - header->names_offset;
+
+    const vk_shader_pack_entry* entries = (const vk_shader_pack_entry*)(pack->data + sizeof(vk_shader_pack_header));
+    for(uint32_t i = 0; valid && i < header->entry_count; i++)
+    {
+        const vk_shader_pack_entry& entry = entries[i];
+        valid = entry.data_offset % 4 == 0 && entry.data_size % 4 == 0 && entry.data_size > 0 &&
+                entry.data_offset <= pack->size && entry.data_size <= pack->size - entry.data_offset &&
+                (uint64_t)entry.name_offset + entry.name_size <= header->names_size &&
+                (i == 0 || entries[i - 1].path_hash <= entry.path_hash);
+    }
+
+    if(!valid)
+    {
+        std::cerr << "Shader pack " << path << " is corrupt" << std::endl;
+        vk_shader_pack_close(*pack);
+        return -1;
+    }
+
+    pack->header = header;
+    pack->entries = entries;
+
+    return 0;
+}
+
+void vk_shader_pack_close(vk_shader_pack& pack)
+{
+    if(pack.data == NULL) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(pack.data);
+    CloseHandle((HANDLE)pack.mapping);
+    CloseHandle((HANDLE)pack.file);
+#else
+    munmap((void*)pack.data, pack.size);
+#endif
+
+    pack = vk_shader_pack{};
+}
+
+int vk_shader_pack_find(const vk_shader_pack& pack, const std::string& path, const uint32_t** code, size_t* size)
+{
+    if(pack.data == NULL) return -1;
+
+    std::string name = vk_shader_pack_normalize(path);
+    uint64_t hash = vk_shader_pack_hash(name.data(), name.size());
+
+    const vk_shader_pack_entry* begin = pack.entries;
+    const vk_shader_pack_entry* end = pack.entries + pack.header->entry_count;
+    const vk_shader_pack_entry* entry = std::lower_bound(begin, end, hash, [](const vk_shader_pack_entry& e, uint64_t h) { return e.path_hash < h; });
+
+    const char* names = (const char*)pack.data + pack.header->names_offset;
+    for(; entry != end && entry->path_hash == hash; entry++)
+    {
+        if(entry->name_size == name.size() && memcmp(names + entry->name_offset, name.data(), name.size()) == 0)
+        {
+            *code = (const uint32_t*)(pack.data + entry->data_offset);
+            *size = entry->data_size;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+std::string vk_shader_pack_normalize(const std::string& path)
+{
+    std::string name = path;
+    std::replace(name.begin(), name.end(), '\\', '/');
+
+    for(;;)
+    {
+        if(name.compare(0, 2, "./") == 0) name.erase(0, 2);
+        else if(name.compare(0, 3, "../") == 0) name.erase(0, 3);
+        else break;
+    }
+
+    return name;
+}
+
+// FNV-1a
+uint64_t vk_shader_pack_hash(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Shader pack archive
+// Every SPIR-V module lives in one file that is mapped once, shader modules are created straight from the mapping.
+// Layout: header | entries (sorted by path hash) | name strings | module data (each VK_SHADER_PACK_ALIGNMENT aligned)
+// Modules are stored once per distinct content hash, several paths can point at the same data.
+// Paths are normalized before hashing (\ becomes /, leading ./ and ../ are dropped) so "../vert.spv" finds "vert.spv".
+// Packs are written by tools/shader_pack.cpp.
+
+#define VK_SHADER_PACK_MAGIC 0x4B415053     // "SPAK"
+#define VK_SHADER_PACK_VERSION 1
+#define VK_SHADER_PACK_ALIGNMENT 16
+
+struct vk_shader_pack_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+    uint64_t names_offset;
+    uint64_t names_size;
+};
+
+struct vk_shader_pack_entry
+{
+    uint64_t path_hash;
+    uint64_t content_hash;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint32_t name_offset;   // Relative to names_offset, not null terminated
+    uint32_t name_size;
+};
+
+struct vk_shader_pack
+{
+    const uint8_t* data;    // NULL when no pack is open
+    size_t size;
+    const vk_shader_pack_header* header;
+    const vk_shader_pack_entry* entries;
+    void* file;             // Windows file / mapping handles
+    void* mapping;
+};
+
+// Maps the pack at path read only and validates its index
+// 0 - success
+// -1 - failure
+int vk_shader_pack_open(const std::string& path, vk_shader_pack* pack);
+void vk_shader_pack_close(vk_shader_pack& pack);
+
+// Looks up path and points code at its SPIR-V inside the mapping, valid until the pack is closed
+// 0 - found
+// -1 - not in the pack
+int vk_shader_pack_find(const vk_shader_pack& pack, const std::string& path, const uint32_t** code, size_t* size);
+
+std::string vk_shader_pack_normalize(const std::string& path);
+uint64_t vk_shader_pack_hash(const void* data, size_t size);
@@ -0,0 +1,127 @@
+#include "vk_staging.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#define STAGING_ALIGNMENT 16
+
+int vk_staging_ring_create(vk_allocator& allocator, VkDeviceSize capacity, vk_staging_ring* ring)
+{
+    if(ring == NULL || capacity == 0) return -1;
+
+    if(vk_buffer_create(allocator, capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &ring->buffer) < 0)
+    {
+        std::cerr << "Failed to create staging ring buffer" << std::endl;
+        return -1;
+    }
+
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return 0;
+}
+
+void vk_staging_ring_destroy(vk_allocator& allocator, vk_staging_ring& ring)
+{
+    vk_buffer_destroy(allocator, ring.buffer);
+    ring.pending.clear();
+    ring.in_flight.clear();
+}
+
+int vk_staging_ring_upload(vk_staging_ring& ring, VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size)
+{
+    if(size == 0) return 0;
+
+    VkDeviceSize aligned_size = (size + STAGING_ALIGNMENT - 1) & ~((VkDeviceSize)STAGING_ALIGNMENT - 1);
+    VkDeviceSize head = ring.head;
+    VkDeviceSize offset = head % ring.capacity;
+
+    // Copies have to be contiguous so skip whatever is left at the end of the ring if it doesn't fit
+    if(offset + aligned_size > ring.capacity)
+    {
+        head += ring.capacity - offset;
+        offset = 0;
+    }
+
+    if(head + aligned_size - ring.tail > ring.capacity)
+    {
+        return -1;
+    }
+
+    memcpy((char*)ring.buffer.allocation.mapped + offset, data, size);
+
+    vk_staging_copy copy{};
+    copy.dst = dst;
+    copy.region.srcOffset = offset;
+    copy.region.dstOffset = dst_offset;
+    copy.region.size = size;
+    ring.pending.push_back(copy);
+
+    ring.head = head + aligned_size;
+
+    return 0;
+}
+
+static uint32_t record_copies(vk_staging_ring& ring, VkCommandBuffer cmd, uint64_t serial, uint8_t barrier)
+{
+    if(ring.pending.empty()) return 0;
+
+    // Group copies by destination so each buffer gets a single vkCmdCopyBuffer with all of its regions
+    std::stable_sort(ring.pending.begin(), ring.pending.end(), [](const vk_staging_copy& a, const vk_staging_copy& b) { return a.dst < b.dst; });
+
+    std::vector<VkBufferCopy> regions;
+    regions.reserve(ring.pending.size());
+
+    for(size_t i = 0; i < ring.pending.size();)
+    {
+        VkBuffer dst = ring.pending[i].dst;
+        regions.clear();
+        for(; i < ring.pending.size() && ring.pending[i].dst == dst; i++)
+        {
+            regions.push_back(ring.pending[i].region);
+        }
+
+        vkCmdCopyBuffer(cmd, ring.buffer.buffer, dst, regions.size(), regions.data());
+    }
+
+    if(barrier)
+    {
+        VkMemoryBarrier memory_barrier{};
+        memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &memory_barrier, 0, NULL, 0, NULL);
+    }
+
+    uint32_t count = ring.pending.size();
+    ring.pending.clear();
+    ring.in_flight.push_back(vk_staging_fence{ serial, ring.head });
+
+    return count;
+}
+
+uint32_t vk_staging_ring_record(vk_staging_ring& ring, VkCommandBuffer cmd, uint64_t serial)
+{
+    return record_copies(ring, cmd, serial, 1);
+}
+
+uint32_t vk_staging_ring_record_transfer(vk_staging_ring& ring, VkCommandBuffer cmd, uint64_t serial)
+{
+    return record_copies(ring, cmd, serial, 0);
+}
+
+void vk_staging_ring_retire(vk_staging_ring& ring, uint64_t completed_serial)
+{
+    size_t retired = 0;
+    while(retired < ring.in_flight.size() && ring.in_flight[retired].serial <= completed_serial)
+    {
+        ring.tail = ring.in_flight[retired].head;
+        retired++;
+    }
+
+    ring.in_flight.erase(ring.in_flight.begin(), ring.in_flight.begin() + retired);
+}
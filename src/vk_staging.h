@@ -0,0 +1,52 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "vk_allocator.h"
+
+// Persistently mapped ring buffer used to stream data into device local buffers
+// Uploads are only memcpy'd into the ring, every pending copy is then recorded in one go (one vkCmdCopyBuffer per
+// destination buffer + a single barrier) so a frame's worth of uploads costs one transfer submission.
+// Space is handed back once the submission that consumed it is known to be complete (see vk_staging_ring_retire).
+
+struct vk_staging_copy
+{
+    VkBuffer dst;
+    VkBufferCopy region;
+};
+
+// Ring position that becomes free once the submission tagged with serial has completed
+struct vk_staging_fence
+{
+    uint64_t serial;
+    VkDeviceSize head;
+};
+
+struct vk_staging_ring
+{
+    vk_buffer buffer;
+    VkDeviceSize capacity;
+    VkDeviceSize head;      // Total bytes ever written (position is head % capacity)
+    VkDeviceSize tail;      // Total bytes ever released
+    std::vector<vk_staging_copy> pending;
+    std::vector<vk_staging_fence> in_flight;
+};
+
+int vk_staging_ring_create(vk_allocator& allocator, VkDeviceSize capacity, vk_staging_ring* ring);
+void vk_staging_ring_destroy(vk_allocator& allocator, vk_staging_ring& ring);
+
+// Copies size bytes of data into the ring and queues a copy to dst at dst_offset
+// 0 - success
+// -1 - not enough free space in the ring, record / retire outstanding work and try again
+int vk_staging_ring_upload(vk_staging_ring& ring, VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size);
+
+// Records every pending copy into cmd followed by a barrier making them visible to vertex input / graphics and compute shaders
+// serial identifies the submission cmd ends up in, pass it to vk_staging_ring_retire once that has completed
+// Returns the number of copies recorded
+uint32_t vk_staging_ring_record(vk_staging_ring& ring, VkCommandBuffer cmd, uint64_t serial);
+
+// Same as vk_staging_ring_record but for a command buffer on a dedicated transfer queue, which can't use the graphics
+// stages the barrier targets. The consumer waiting on the transfer submission's semaphore makes the copies visible instead.
+uint32_t vk_staging_ring_record_transfer(vk_staging_ring& ring, VkCommandBuffer cmd, uint64_t serial);
+
+// Releases ring space used by every submission with a serial <= completed_serial
+void vk_staging_ring_retire(vk_staging_ring& ring, uint64_t completed_serial);
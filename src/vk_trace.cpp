@@ -0,0 +1,77 @@
+#include "vk_trace.h"
+#include <fstream>
+#include <iostream>
+
+double vk_trace_time_us(std::chrono::steady_clock::time_point time)
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(time - start).count();
+}
+
+double vk_trace_now_us()
+{
+    return vk_trace_time_us(std::chrono::steady_clock::now());
+}
+
+void vk_trace_add(vk_trace& trace, const std::string& name, const char* category, uint32_t pid, uint32_t tid, double start_us, double duration_us, const std::string& args)
+{
+    vk_trace_event event;
+    event.name = name;
+    event.category = category;
+    event.pid = pid;
+    event.tid = tid;
+    event.start_us = start_us;
+    event.duration_us = duration_us;
+    event.args = args;
+    trace.events.push_back(event);
+}
+
+static void write_string(std::ofstream& file, const std::string& text)
+{
+    file << '"';
+    for(char c : text)
+    {
+        if(c == '"' || c == '\\') file << '\\' << c;
+        else if((unsigned char)c < 0x20) file << ' ';
+        else file << c;
+    }
+    file << '"';
+}
+
+int vk_trace_write(const vk_trace& trace, const std::string& path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if(!file.is_open())
+    {
+        std::cerr << "Failed to open trace file " << path << std::endl;
+        return -1;
+    }
+
+    file << "{\"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << VK_TRACE_PID_CPU << ", \"args\": {\"name\": \"CPU\"}},\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << VK_TRACE_PID_GPU << ", \"args\": {\"name\": \"GPU\"}}";
+
+    file.precision(3);
+    file << std::fixed;
+    for(const vk_trace_event& event : trace.events)
+    {
+        file << ",\n{\"name\": ";
+        write_string(file, event.name);
+        file << ", \"cat\": \"" << event.category << "\", \"ph\": \"X\", \"pid\": " << event.pid << ", \"tid\": " << event.tid
+             << ", \"ts\": " << event.start_us << ", \"dur\": " << event.duration_us;
+        if(!event.args.empty())
+        {
+            file << ", \"args\": {" << event.args << "}";
+        }
+        file << "}";
+    }
+    file << "\n]}\n";
+
+    if(!file.good())
+    {
+        std::cerr << "Failed to write trace file " << path << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <chrono>
+
+// Chrome trace capture
+// Complete ("ph": "X") events on a shared microsecond timeline, written out as the JSON chrome://tracing and Perfetto
+// load. CPU scopes go on VK_TRACE_PID_CPU, GPU regions (see vk_gpu_profiler.h) on VK_TRACE_PID_GPU. tid is whatever
+// track the caller picks: vk_cpu_profiler numbers threads in the order they first record, events that belong to no
+// particular thread use 0. Events are kept in memory until vk_trace_write, a capture grows by a few events per frame.
+
+#define VK_TRACE_PID_CPU 1
+#define VK_TRACE_PID_GPU 2
+
+struct vk_trace_event
+{
+    std::string name;
+    const char* category;
+    uint32_t pid;
+    uint32_t tid;
+    double start_us;
+    double duration_us;
+    std::string args;       // Members of the event's args object (e.g. "\"draws\": 3"), may be empty
+};
+
+struct vk_trace
+{
+    std::vector<vk_trace_event> events;
+};
+
+// Microseconds on the steady clock since the first call to either, the timeline every event is on
+double vk_trace_now_us();
+double vk_trace_time_us(std::chrono::steady_clock::time_point time);
+
+void vk_trace_add(vk_trace& trace, const std::string& name, const char* category, uint32_t pid, uint32_t tid, double start_us, double duration_us, const std::string& args);
+
+// 0 - success
+// -1 - failure
+int vk_trace_write(const vk_trace& trace, const std::string& path);
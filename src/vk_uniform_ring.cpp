@@ -0,0 +1,83 @@
+#include "vk_uniform_ring.h"
+#include "vklib.h"
+#include <iostream>
+
+int vk_uniform_ring_create(vk_context& context, VkDeviceSize frame_size, uint32_t frame_count, vk_uniform_ring* ring)
+{
+    if(ring == NULL || frame_size == 0 || frame_count == 0) return -1;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+
+    // Both limits are powers of two so the larger one satisfies both
+    VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+    if(properties.limits.minStorageBufferOffsetAlignment > alignment) alignment = properties.limits.minStorageBufferOffsetAlignment;
+    if(alignment < 16) alignment = 16;
+
+    ring->alignment = alignment;
+    ring->frame_size = (frame_size + alignment - 1) & ~(alignment - 1);
+    ring->frame_count = frame_count;
+
+    // Vertex buffer usage lets per instance streams come straight out of the ring (see vk_instancing.h)
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    // Device local + host visible (resizable BAR / UMA) keeps shader reads out of system memory, plain host memory otherwise
+    VkMemoryPropertyFlags memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if(vk_allocator_find_memory_type(context.allocator, UINT32_MAX, memory_properties | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) >= 0)
+    {
+        memory_properties |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    }
+
+    if(vk_buffer_create(context.allocator, ring->frame_size * frame_count, usage, memory_properties, &ring->buffer) < 0)
+    {
+        std::cerr << "Failed to create uniform ring buffer" << std::endl;
+        return -1;
+    }
+
+    VkBufferDeviceAddressInfo address_info{};
+    address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    address_info.buffer = ring->buffer.buffer;
+    ring->address = vkGetBufferDeviceAddress(context.logical_device, &address_info);
+
+    ring->bindless_index = vk_bindless_add_buffer(context.logical_device, context.bindless, ring->buffer.buffer, 0, VK_WHOLE_SIZE);
+
+    ring->frame_offset = 0;
+    ring->head = 0;
+
+    return 0;
+}
+
+void vk_uniform_ring_destroy(vk_context& context, vk_uniform_ring& ring)
+{
+    vk_bindless_remove(context.bindless, VK_BINDLESS_STORAGE_BUFFER, ring.bindless_index, 0);
+    vk_buffer_destroy(context.allocator, ring.buffer);
+}
+
+void vk_uniform_ring_begin_frame(vk_uniform_ring& ring, uint32_t frame)
+{
+    ring.frame_offset = (frame % ring.frame_count) * ring.frame_size;
+    ring.head.store(0, std::memory_order_relaxed);
+}
+
+int vk_uniform_ring_alloc(vk_uniform_ring& ring, VkDeviceSize size, vk_uniform_allocation* allocation)
+{
+    VkDeviceSize aligned_size = (size + ring.alignment - 1) & ~(ring.alignment - 1);
+    VkDeviceSize offset = ring.head.fetch_add(aligned_size, std::memory_order_relaxed);
+
+    if(offset + aligned_size > ring.frame_size)
+    {
+        // Only the allocation that crossed the end reports, the ones after it start past it
+        if(offset <= ring.frame_size)
+        {
+            std::cerr << "Uniform ring is full, " << ring.frame_size << " bytes per frame are not enough for this frame" << std::endl;
+        }
+        return -1;
+    }
+
+    offset += ring.frame_offset;
+    allocation->data = (char*)ring.buffer.allocation.mapped + offset;
+    allocation->offset = offset;
+    allocation->address = ring.address + offset;
+
+    return 0;
+}
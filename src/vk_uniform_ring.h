@@ -0,0 +1,43 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include "vk_allocator.h"
+
+struct vk_context;
+
+// Per frame linear allocator for uniform / storage data written by the CPU every frame
+// One persistently mapped buffer split into a region per frame in flight. Allocating bumps an atomic offset (safe from
+// any recording thread), resetting a region is just setting that offset back to zero once the frame using it retired.
+// Shaders reach the data either through the allocation's buffer device address (e.g. passed in a push constant) or
+// through the buffer's bindless storage buffer index plus the allocation's offset; nothing is bound per draw.
+// The buffer is also a vertex buffer so per instance data can be bound straight from an allocation's offset.
+
+struct vk_uniform_allocation
+{
+    void* data;                 // Mapped pointer to write the constants to
+    VkDeviceSize offset;        // From the start of the buffer (dynamic offset / bindless buffer offset)
+    VkDeviceAddress address;
+};
+
+struct vk_uniform_ring
+{
+    vk_buffer buffer;
+    VkDeviceSize frame_size;
+    uint32_t frame_count;
+    VkDeviceSize alignment;         // Covers both minUniformBufferOffsetAlignment and minStorageBufferOffsetAlignment
+    VkDeviceAddress address;
+    uint32_t bindless_index;        // The whole buffer as a storage buffer in the context's bindless heap
+    VkDeviceSize frame_offset;      // Start of the current frame's region
+    std::atomic<VkDeviceSize> head; // Bytes used in the current frame's region
+};
+
+int vk_uniform_ring_create(vk_context& context, VkDeviceSize frame_size, uint32_t frame_count, vk_uniform_ring* ring);
+void vk_uniform_ring_destroy(vk_context& context, vk_uniform_ring& ring);
+
+// Switches to frame's region and empties it, the previous frame submitted from that slot must have completed
+void vk_uniform_ring_begin_frame(vk_uniform_ring& ring, uint32_t frame);
+
+// Reports the overflow once per frame, callers must fail the frame rather than skip what the allocation was for
+// 0 - success
+// -1 - the frame's region is full
+int vk_uniform_ring_alloc(vk_uniform_ring& ring, VkDeviceSize size, vk_uniform_allocation* allocation);
@@ -1,64 +1,49 @@
 #include "vklib.h"
+#include "vk_embedded_shaders.h"
+#include "vk_cpu_profiler.h"
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <iostream>
 #include <algorithm>
 #include <fstream>
+#include <cstring>
+#include <cstdio>
 
+#ifdef VK_DEBUG_LAYERS
 static VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
 static void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator);
-static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData);
+#endif
 queue_families vk_get_device_queues(const VkPhysicalDevice& physical_device, vk_context& context);
-static int vk_create_swapchain(vk_context* context, GLFWwindow* window);
+static int vk_create_instance(vk_context* context, std::vector<const char*>& extensions);
+static int vk_device_supports_extensions(const VkPhysicalDevice& physical_device, const std::vector<const char*>& required_extensions);
+static int vk_device_supports_features(const VkPhysicalDevice& physical_device);
+static int vk_device_supports_present_wait(const VkPhysicalDevice& physical_device);
+static int vk_create_device(vk_context* context, const std::vector<const char*>& device_extensions);
+static int vk_create_swapchain(vk_context* context, VkSwapchainKHR old_swapchain);
+static void vk_destroy_swapchain_views(vk_context* context, std::vector<VkImageView>& image_views);
+static int vk_create_offscreen_target(vk_context* context, uint32_t width, uint32_t height, uint32_t image_count);
+static int vk_load_pipeline_cache(vk_context* context);
+static int vk_save_pipeline_cache(vk_context* context);
 static std::vector<char> load_file_bytes(const std::string& path);
 
+#ifdef VK_DEBUG_LAYERS
+static const std::vector<const char*> validation_layers = { "VK_LAYER_KHRONOS_validation" };
+#endif
+
 int vk_init(vk_context* context, GLFWwindow* window)
 {
 
     if(context == NULL || window == NULL) return -1;
 
-    VkApplicationInfo app_info{};
-    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    app_info.apiVersion = VK_API_VERSION_1_4;
-    app_info.pApplicationName = "vulkan-renderer";
-    app_info.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-    app_info.pEngineName = "None";
-    app_info.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-
-    VkInstanceCreateInfo instance_info{};
-    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-    instance_info.pApplicationInfo = &app_info;
+    context->window = window;
 
     uint32_t extension_count = 0;
     const char** glfw_extensions;
     glfw_extensions = glfwGetRequiredInstanceExtensions(&extension_count);
     std::vector<const char*> extensions(glfw_extensions, glfw_extensions + extension_count);
-    extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
-    std::vector<const char*> validation_layers = { "VK_LAYER_KHRONOS_validation" };
-
-    instance_info.enabledExtensionCount = extensions.size();
-    instance_info.ppEnabledExtensionNames = extensions.data();
-    instance_info.enabledLayerCount = validation_layers.size();
-    instance_info.ppEnabledLayerNames = validation_layers.data();
-
-    VkDebugUtilsMessengerCreateInfoEXT debug_info{};
-    debug_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    debug_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    debug_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-    debug_info.pfnUserCallback = debug_callback;
-
-    instance_info.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debug_info;
-    
-    if(vkCreateInstance(&instance_info, NULL, &(context->instance)) != VK_SUCCESS)
-    {
-        std::cerr << "Failed to create vulkan instance" << std::endl;
-        return -1;
-    }
-
-    if(CreateDebugUtilsMessengerEXT(context->instance, &debug_info, NULL, &context->debug_messenger) != VK_SUCCESS)
+    if(vk_create_instance(context, extensions) < 0)
     {
-        std::cerr << "Failed to create debug messenger" << std::endl;
         return -1;
     }
 
@@ -81,25 +66,8 @@ int vk_init(vk_context* context, GLFWwindow* window)
     {
         queue_families queues = vk_get_device_queues(gpu, *context);
 
-        uint32_t extension_count;
-        vkEnumerateDeviceExtensionProperties(gpu, NULL, &extension_count, NULL);
-        std::vector<VkExtensionProperties> available_extensions(extension_count);
-        vkEnumerateDeviceExtensionProperties(gpu, NULL, &extension_count, available_extensions.data());
-
-        uint32_t supported = 0;
-        for(int i = 0; i < required_device_extensions.size(); i++)
-        {
-            for(int j = 0; j < available_extensions.size(); j++)
-            {
-                if(strcmp(required_device_extensions[i], available_extensions[j].extensionName) == 0)
-                {
-                    supported++;
-                }
-            }
-        }
-
         uint32_t swapchain_adequate = 0;
-        if(supported == required_device_extensions.size())
+        if(vk_device_supports_extensions(gpu, required_device_extensions) && vk_device_supports_features(gpu))
         {
             uint32_t format_count;
             vkGetPhysicalDeviceSurfaceFormatsKHR(gpu, context->surface, &format_count, NULL);
@@ -127,47 +95,322 @@ int vk_init(vk_context* context, GLFWwindow* window)
         return -1;
     }
 
+    // Low latency paces frames on present completion and frame telemetry times presents with it, without present wait
+    // low latency only gets the short swapchain
+    std::vector<const char*> present_wait_extensions = { VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME };
+    if(vk_device_supports_extensions(context->physical_device, present_wait_extensions) && vk_device_supports_present_wait(context->physical_device))
+    {
+        required_device_extensions.insert(required_device_extensions.end(), present_wait_extensions.begin(), present_wait_extensions.end());
+        context->present_wait = 1;
+    }
+    else if(context->present_policy == VK_PRESENT_POLICY_LOW_LATENCY)
+    {
+        std::cerr << "Present wait is not supported, low latency presentation falls back to a minimal FIFO swapchain" << std::endl;
+    }
+
+    if(vk_create_device(context, required_device_extensions) < 0)
+    {
+        return -1;
+    }
+
+    if(vk_create_swapchain(context, VK_NULL_HANDLE) < 0)
+    {
+        std::cerr << "Failed to create swapchain" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+int vk_init_headless(vk_context* context, uint32_t width, uint32_t height, uint32_t image_count)
+{
+    if(context == NULL || width == 0 || height == 0 || image_count == 0) return -1;
+
+    context->headless = 1;
+
+    // No window system integration here, so no instance extensions at all; vk_create_instance adds debug utils itself
+    // when validation is built in (VK_DEBUG_LAYERS) and enabled
+    std::vector<const char*> extensions;
+    if(vk_create_instance(context, extensions) < 0)
+    {
+        return -1;
+    }
+
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(context->instance, &device_count, NULL);
+    std::vector<VkPhysicalDevice> devices(device_count);
+    vkEnumeratePhysicalDevices(context->instance, &device_count, devices.data());
+
+    std::vector<const char*> required_device_extensions = { VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME };
+
+    // Without a surface the only thing that matters is being able to run graphics work.
+    // Prefer real hardware but fall back to anything (e.g. lavapipe) that has a graphics queue.
+    VkPhysicalDevice fallback = VK_NULL_HANDLE;
+    for(const VkPhysicalDevice& gpu : devices)
+    {
+        queue_families queues = vk_get_device_queues(gpu, *context);
+        if(!queues.has_graphics || !vk_device_supports_extensions(gpu, required_device_extensions) || !vk_device_supports_features(gpu)) continue;
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(gpu, &properties);
+
+        if(properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU || properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
+        {
+            context->physical_device = gpu;
+            break;
+        }
+
+        if(fallback == VK_NULL_HANDLE)
+        {
+            fallback = gpu;
+        }
+    }
+
+    if(context->physical_device == VK_NULL_HANDLE)
+    {
+        context->physical_device = fallback;
+    }
+
+    if(context->physical_device == VK_NULL_HANDLE)
+    {
+        std::cerr << "Failed to find adequate physical device" << std::endl;
+        return -1;
+    }
+
+    if(vk_create_device(context, required_device_extensions) < 0)
+    {
+        return -1;
+    }
+
+    if(vk_create_offscreen_target(context, width, height, image_count) < 0)
+    {
+        std::cerr << "Failed to create offscreen render target" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int vk_create_instance(vk_context* context, std::vector<const char*>& extensions)
+{
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.apiVersion = VK_API_VERSION_1_4;
+    app_info.pApplicationName = "vulkan-renderer";
+    app_info.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+    app_info.pEngineName = "None";
+    app_info.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+
+#ifdef VK_DEBUG_LAYERS
+    // Chained into the instance info as well so instance creation / destruction is reported too (see vk_debug.h)
+    VkDebugUtilsMessengerCreateInfoEXT debug_info{};
+    if(context->debug.validation)
+    {
+        context->debug_log = vk_debug_log_create(context->debug);
+        if(context->debug_log == NULL)
+        {
+            std::cerr << "Failed to create debug log" << std::endl;
+            return -1;
+        }
+        vk_debug_log_messenger_info(context->debug_log, &debug_info);
+
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        instance_info.enabledLayerCount = validation_layers.size();
+        instance_info.ppEnabledLayerNames = validation_layers.data();
+        instance_info.pNext = &debug_info;
+    }
+#endif
+
+    instance_info.enabledExtensionCount = extensions.size();
+    instance_info.ppEnabledExtensionNames = extensions.data();
+
+    if(vkCreateInstance(&instance_info, NULL, &(context->instance)) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create vulkan instance" << std::endl;
+        return -1;
+    }
+
+#ifdef VK_DEBUG_LAYERS
+    if(context->debug_log != NULL && CreateDebugUtilsMessengerEXT(context->instance, &debug_info, NULL, &context->debug_messenger) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create debug messenger" << std::endl;
+        return -1;
+    }
+#endif
+
+    return 0;
+}
+
+static int vk_device_supports_extensions(const VkPhysicalDevice& physical_device, const std::vector<const char*>& required_extensions)
+{
+    uint32_t extension_count;
+    vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, NULL);
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, available_extensions.data());
+
+    uint32_t supported = 0;
+    for(int i = 0; i < required_extensions.size(); i++)
+    {
+        for(int j = 0; j < available_extensions.size(); j++)
+        {
+            if(strcmp(required_extensions[i], available_extensions[j].extensionName) == 0)
+            {
+                supported++;
+            }
+        }
+    }
+
+    return supported == required_extensions.size();
+}
+
+// Everything vk_create_device turns on, the Vulkan 1.2 / 1.3 feature structs need a 1.3 device
+static int vk_device_supports_features(const VkPhysicalDevice& physical_device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    if(properties.apiVersion < VK_API_VERSION_1_3) return 0;
+
+    VkPhysicalDeviceVulkan13Features vulkan13_features{};
+    vulkan13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+    VkPhysicalDeviceVulkan12Features vulkan12_features{};
+    vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12_features.pNext = &vulkan13_features;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12_features;
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    return vulkan12_features.timelineSemaphore && vulkan13_features.synchronization2 && vulkan13_features.dynamicRendering &&
+           vulkan12_features.descriptorIndexing && vulkan12_features.runtimeDescriptorArray && vulkan12_features.descriptorBindingPartiallyBound &&
+           vulkan12_features.descriptorBindingSampledImageUpdateAfterBind && vulkan12_features.descriptorBindingStorageBufferUpdateAfterBind &&
+           vulkan12_features.descriptorBindingUpdateUnusedWhilePending && vulkan12_features.shaderSampledImageArrayNonUniformIndexing &&
+           vulkan12_features.shaderStorageBufferArrayNonUniformIndexing && vulkan12_features.bufferDeviceAddress &&
+           vulkan12_features.drawIndirectCount && features.features.multiDrawIndirect && features.features.drawIndirectFirstInstance;
+}
+
+static int vk_device_supports_present_wait(const VkPhysicalDevice& physical_device)
+{
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{};
+    present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features{};
+    present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    present_id_features.pNext = &present_wait_features;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &present_id_features;
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    return present_id_features.presentId && present_wait_features.presentWait;
+}
+
+static int vk_create_device(vk_context* context, const std::vector<const char*>& device_extensions)
+{
     queue_families queues = vk_get_device_queues(context->physical_device, *context);
 
     float queue_priority = 1.0;
 
-    VkDeviceQueueCreateInfo graphics_queue_info{};
-    graphics_queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    graphics_queue_info.queueFamilyIndex = queues.graphics;
-    graphics_queue_info.queueCount = 1;
-    graphics_queue_info.pQueuePriorities = &queue_priority;
-
-    VkDeviceQueueCreateInfo present_queue_info{};
-    present_queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    present_queue_info.queueFamilyIndex = queues.present;
-    present_queue_info.queueCount = 1;
-    present_queue_info.pQueuePriorities = &queue_priority;
+    // One queue per distinct family, present usually shares the graphics family and headless contexts have no present queue at all
+    std::vector<uint32_t> families = { queues.graphics };
+    if(queues.has_present) families.push_back(queues.present);
+    if(queues.has_transfer) families.push_back(queues.transfer);
+    if(queues.has_compute) families.push_back(queues.compute);
 
-    // Make sure we don't repeat the same queue index if present == graphics
+    std::vector<uint32_t> unique_families;
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-    queue_create_infos.push_back(graphics_queue_info);
-    if(queues.graphics != queues.present)
+    for(uint32_t family : families)
     {
-        queue_create_infos.push_back(present_queue_info);
+        if(std::find(unique_families.begin(), unique_families.end(), family) != unique_families.end()) continue;
+        unique_families.push_back(family);
+
+        VkDeviceQueueCreateInfo queue_info{};
+        queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queue_info.queueFamilyIndex = family;
+        queue_info.queueCount = 1;
+        queue_info.pQueuePriorities = &queue_priority;
+        queue_create_infos.push_back(queue_info);
     }
 
+    // GPU driven draws come out of one multi draw indirect call and carry their object index in firstInstance (see vk_gpu_scene.h)
     VkPhysicalDeviceFeatures device_features{};
+    device_features.multiDrawIndirect = VK_TRUE;
+    device_features.drawIndirectFirstInstance = VK_TRUE;
+
+    // Optional, the GPU profiler only collects pipeline statistics where it's there (see vk_gpu_profiler.h). Passes
+    // record into secondaries, so statistics queries around them need inherited queries as well
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(context->physical_device, &supported_features);
+    if(supported_features.pipelineStatisticsQuery && supported_features.inheritedQueries)
+    {
+        device_features.pipelineStatisticsQuery = VK_TRUE;
+        device_features.inheritedQueries = VK_TRUE;
+        context->pipeline_statistics = 1;
+    }
 
     VkDeviceCreateInfo logical_device_info{};
     logical_device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     logical_device_info.pQueueCreateInfos = queue_create_infos.data();
     logical_device_info.queueCreateInfoCount = queue_create_infos.size();
     logical_device_info.pEnabledFeatures = &device_features;
-    logical_device_info.enabledExtensionCount = required_device_extensions.size();
-    logical_device_info.ppEnabledExtensionNames = required_device_extensions.data();
-    logical_device_info.enabledLayerCount = validation_layers.size();
-    logical_device_info.ppEnabledLayerNames = validation_layers.data();
-
-    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_feature{};
-    dynamic_rendering_feature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
-    dynamic_rendering_feature.dynamicRendering = VK_TRUE;
+    logical_device_info.enabledExtensionCount = device_extensions.size();
+    logical_device_info.ppEnabledExtensionNames = device_extensions.data();
+#ifdef VK_DEBUG_LAYERS
+    // Device layers are ignored by current loaders, set for older ones
+    if(context->debug_log != NULL)
+    {
+        logical_device_info.enabledLayerCount = validation_layers.size();
+        logical_device_info.ppEnabledLayerNames = validation_layers.data();
+    }
+#endif
+
+    // Timeline semaphores and synchronization2 are what async queue submissions synchronize with (see vk_queue.h)
+    VkPhysicalDeviceVulkan13Features vulkan13_features{};
+    vulkan13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan13_features.dynamicRendering = VK_TRUE;
+    vulkan13_features.synchronization2 = VK_TRUE;
+
+    VkPhysicalDeviceVulkan12Features vulkan12_features{};
+    vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12_features.pNext = &vulkan13_features;
+    vulkan12_features.timelineSemaphore = VK_TRUE;
+
+    // Descriptor indexing for the bindless heap (see vk_bindless.h)
+    vulkan12_features.descriptorIndexing = VK_TRUE;
+    vulkan12_features.runtimeDescriptorArray = VK_TRUE;
+    vulkan12_features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan12_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan12_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    vulkan12_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    vulkan12_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    vulkan12_features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+
+    // Per draw data is read through buffer device addresses (see vk_uniform_ring.h)
+    vulkan12_features.bufferDeviceAddress = VK_TRUE;
+    vulkan12_features.drawIndirectCount = VK_TRUE;
+
+    // Present ids / present wait for the low latency present policy and present timing (see vk_swapchain_wait_present)
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{};
+    present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    present_wait_features.presentWait = VK_TRUE;
+
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features{};
+    present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    present_id_features.pNext = &present_wait_features;
+    present_id_features.presentId = VK_TRUE;
+
+    if(context->present_wait)
+    {
+        vulkan13_features.pNext = &present_id_features;
+    }
 
-    logical_device_info.pNext = &dynamic_rendering_feature;
+    logical_device_info.pNext = &vulkan12_features;
 
     if(vkCreateDevice(context->physical_device, &logical_device_info, NULL, &(context->logical_device)) != VK_SUCCESS)
     {
@@ -175,39 +418,72 @@ int vk_init(vk_context* context, GLFWwindow* window)
         return -1;
     }
 
-    if(vk_create_swapchain(context, window) < 0)
+    // Device level extension function, the loader doesn't export it
+    if(context->present_wait)
+    {
+        context->wait_for_present = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(context->logical_device, "vkWaitForPresentKHR");
+        if(context->wait_for_present == NULL)
+        {
+            context->present_wait = 0;
+        }
+    }
+
+    if(vk_allocator_create(context->physical_device, context->logical_device, &context->allocator) < 0)
+    {
+        std::cerr << "Failed to create device memory allocator" << std::endl;
+        return -1;
+    }
+    context->allocator.buffer_queue_families = unique_families;
+    context->allocator.allocate_flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+    if(vk_load_pipeline_cache(context) < 0)
+    {
+        std::cerr << "Failed to create pipeline cache" << std::endl;
+        return -1;
+    }
+
+    if(vk_bindless_create(context->physical_device, context->logical_device, &context->bindless) < 0)
     {
-        std::cerr << "Failed to create swapchain" << std::endl;
         return -1;
     }
 
     return 0;
 }
 
-int vk_shader_create(const std::string& vert_path, const std::string& frag_path, vk_context& context, vk_shader* shader)
+// Resolves path through the shader pack (if one is open), then the shaders built into the binary and only then the filesystem
+static int vk_create_shader_module(vk_context& context, const std::string& path, VkShaderModule* module)
 {
-    if(shader == NULL) return -1;
+    VkShaderModuleCreateInfo module_info{};
+    module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+
+    std::vector<char> bytes;
+    if(vk_shader_pack_find(context.shader_pack, path, &module_info.pCode, &module_info.codeSize) < 0 &&
+       vk_embedded_shader_find(path, &module_info.pCode, &module_info.codeSize) < 0)
+    {
+        bytes = load_file_bytes(path);
+        module_info.codeSize = bytes.size();
+        module_info.pCode = (const uint32_t*)bytes.data();
+    }
+
+    if(module_info.codeSize == 0 || vkCreateShaderModule(context.logical_device, &module_info, NULL, module) != VK_SUCCESS)
+    {
+        return -1;
+    }
 
-    std::vector<char> vertex_bytes = load_file_bytes(vert_path);
+    return 0;
+}
 
-    VkShaderModuleCreateInfo vertex_info{};
-    vertex_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    vertex_info.codeSize = vertex_bytes.size();
-    vertex_info.pCode = (const uint32_t*)vertex_bytes.data();
+int vk_shader_create(const std::string& vert_path, const std::string& frag_path, vk_context& context, vk_shader* shader)
+{
+    if(shader == NULL) return -1;
 
-    if(vkCreateShaderModule(context.logical_device, &vertex_info, NULL, &shader->vertex) != VK_SUCCESS)
+    if(vk_create_shader_module(context, vert_path, &shader->vertex) < 0)
     {
         std::cerr << "Failed to create vertex shader module" << std::endl;
         return -1;
     }
 
-    std::vector<char> fragment_bytes = load_file_bytes(frag_path);
-    VkShaderModuleCreateInfo fragment_info{};
-    fragment_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    fragment_info.codeSize = fragment_bytes.size();
-    fragment_info.pCode = (const uint32_t*)fragment_bytes.data();
-
-    if(vkCreateShaderModule(context.logical_device, &fragment_info, NULL, &shader->fragment) != VK_SUCCESS)
+    if(vk_create_shader_module(context, frag_path, &shader->fragment) < 0)
     {
         std::cerr << "Failed to create fragment shader module" << std::endl;
         return -1;
@@ -222,110 +498,171 @@ void vk_shader_destroy(vk_context& context, vk_shader& shader)
     vkDestroyShaderModule(context.logical_device, shader.fragment, NULL);
 }
 
-int vk_pipeline_create(vk_context& context, vk_pipeline_config& config, vk_pipeline* pipeline)
+void vk_pipeline_build_state_init(const vk_context& context, const vk_pipeline_config& config, VkPipelineLayout layout, vk_pipeline_build_state* state)
 {
-    if(pipeline == NULL) return -1;
-
-    VkPipelineShaderStageCreateInfo vertex_info{};
-    vertex_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertex_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertex_info.module = config.shader.vertex;
-    vertex_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragment_info{};
-    fragment_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragment_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragment_info.module = config.shader.fragment;
-    fragment_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shader_stages[] = { vertex_info, fragment_info };
-
-
-    // TODO: Come here when implementing vertex buffers
-    VkPipelineVertexInputStateCreateInfo vertex_input_info{};
-    vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_info.vertexBindingDescriptionCount = 0;
-    vertex_input_info.pVertexBindingDescriptions = NULL;
-    vertex_input_info.vertexAttributeDescriptionCount = 0;
-    vertex_input_info.pVertexAttributeDescriptions = NULL;
-
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_info{};
-    input_assembly_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    input_assembly_info.primitiveRestartEnable = VK_FALSE;
-
-    std::vector<VkDynamicState> dynamic_states = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-
-    VkPipelineDynamicStateCreateInfo dynamic_state_info{};
-    dynamic_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamic_state_info.dynamicStateCount = dynamic_states.size();
-    dynamic_state_info.pDynamicStates = dynamic_states.data();
-
-    VkPipelineViewportStateCreateInfo viewport_info{};
-    viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewport_info.viewportCount = 1;
-    viewport_info.scissorCount = 1;
-    //viewport_info.pViewports = &viewports;
-    //viewport_info.pScissors = &scissors;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer_info{};
-    rasterizer_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer_info.depthClampEnable = VK_FALSE;
-    rasterizer_info.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer_info.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer_info.lineWidth = 1.0f;
-    rasterizer_info.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer_info.depthBiasEnable = VK_FALSE;
-    
-    VkPipelineMultisampleStateCreateInfo multisample_info{};
-    multisample_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisample_info.sampleShadingEnable = VK_FALSE;
-    multisample_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    state->stages[0] = VkPipelineShaderStageCreateInfo{};
+    state->stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    state->stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    state->stages[0].module = config.shader.vertex;
+    state->stages[0].pName = "main";
+
+    state->stages[1] = VkPipelineShaderStageCreateInfo{};
+    state->stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    state->stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    state->stages[1].module = config.shader.fragment;
+    state->stages[1].pName = "main";
+
+    state->vertex_input = VkPipelineVertexInputStateCreateInfo{};
+    state->vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    state->vertex_input.vertexBindingDescriptionCount = config.vertex_layout.bindings.size();
+    state->vertex_input.pVertexBindingDescriptions = config.vertex_layout.bindings.data();
+    state->vertex_input.vertexAttributeDescriptionCount = config.vertex_layout.attributes.size();
+    state->vertex_input.pVertexAttributeDescriptions = config.vertex_layout.attributes.data();
+
+    state->input_assembly = VkPipelineInputAssemblyStateCreateInfo{};
+    state->input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    state->input_assembly.topology = config.topology;
+    state->input_assembly.primitiveRestartEnable = VK_FALSE;
+
+    state->dynamic_states[0] = VK_DYNAMIC_STATE_VIEWPORT;
+    state->dynamic_states[1] = VK_DYNAMIC_STATE_SCISSOR;
+
+    state->dynamic_state = VkPipelineDynamicStateCreateInfo{};
+    state->dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    state->dynamic_state.dynamicStateCount = 2;
+    state->dynamic_state.pDynamicStates = state->dynamic_states;
+
+    state->viewport = VkPipelineViewportStateCreateInfo{};
+    state->viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    state->viewport.viewportCount = 1;
+    state->viewport.scissorCount = 1;
+
+    state->rasterizer = VkPipelineRasterizationStateCreateInfo{};
+    state->rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    state->rasterizer.depthClampEnable = VK_FALSE;
+    state->rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    state->rasterizer.polygonMode = config.polygon_mode;
+    state->rasterizer.lineWidth = 1.0f;
+    state->rasterizer.cullMode = config.cull_mode;
+    state->rasterizer.frontFace = config.front_face;
+    state->rasterizer.depthBiasEnable = VK_FALSE;
+
+    state->multisample = VkPipelineMultisampleStateCreateInfo{};
+    state->multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    state->multisample.sampleShadingEnable = VK_FALSE;
+    state->multisample.rasterizationSamples = config.samples;
+
+    state->depth_stencil = VkPipelineDepthStencilStateCreateInfo{};
+    state->depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    state->depth_stencil.depthTestEnable = config.depth_test;
+    state->depth_stencil.depthWriteEnable = config.depth_write;
+    state->depth_stencil.depthCompareOp = config.depth_compare;
+    state->depth_stencil.stencilTestEnable = config.stencil_test;
+    state->depth_stencil.front = config.stencil_front;
+    state->depth_stencil.back = config.stencil_back;
+
+    if(config.depth_only)
+    {
+        state->color_formats.clear();
+    }
+    else if(config.color_formats.empty())
+    {
+        state->color_formats.assign(1, vk_get_color_format(context));
+    }
+    else
+    {
+        state->color_formats = config.color_formats;
+    }
 
     VkPipelineColorBlendAttachmentState blend_attachment{};
-    blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    blend_attachment.blendEnable = VK_FALSE;
-
-    VkPipelineColorBlendStateCreateInfo blend_info{};
-    blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    blend_info.logicOpEnable = VK_FALSE;
-    blend_info.attachmentCount = 1;
-    blend_info.pAttachments = &blend_attachment;
-
+    blend_attachment.colorWriteMask = config.blend.write_mask;
+    blend_attachment.blendEnable = config.blend.enable;
+    blend_attachment.srcColorBlendFactor = config.blend.src_color;
+    blend_attachment.dstColorBlendFactor = config.blend.dst_color;
+    blend_attachment.colorBlendOp = config.blend.color_op;
+    blend_attachment.srcAlphaBlendFactor = config.blend.src_alpha;
+    blend_attachment.dstAlphaBlendFactor = config.blend.dst_alpha;
+    blend_attachment.alphaBlendOp = config.blend.alpha_op;
+    state->blend_attachments.assign(state->color_formats.size(), blend_attachment);
+
+    state->blend = VkPipelineColorBlendStateCreateInfo{};
+    state->blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    state->blend.logicOpEnable = VK_FALSE;
+    state->blend.attachmentCount = state->blend_attachments.size();
+    state->blend.pAttachments = state->blend_attachments.data();
+
+    state->rendering = VkPipelineRenderingCreateInfoKHR{};
+    state->rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    state->rendering.colorAttachmentCount = state->color_formats.size();
+    state->rendering.pColorAttachmentFormats = state->color_formats.data();
+    state->rendering.depthAttachmentFormat = config.depth_format;
+    state->rendering.stencilAttachmentFormat = config.stencil_format;
+
+    state->info = VkGraphicsPipelineCreateInfo{};
+    state->info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    state->info.pNext = &state->rendering;
+    // Depth only pipelines can leave out the fragment stage entirely
+    state->info.stageCount = config.shader.fragment != VK_NULL_HANDLE ? 2 : 1;
+    state->info.pStages = state->stages;
+    state->info.pVertexInputState = &state->vertex_input;
+    state->info.pInputAssemblyState = &state->input_assembly;
+    state->info.pViewportState = &state->viewport;
+    state->info.pRasterizationState = &state->rasterizer;
+    state->info.pMultisampleState = &state->multisample;
+    state->info.pDepthStencilState = config.depth_format != VK_FORMAT_UNDEFINED || config.stencil_format != VK_FORMAT_UNDEFINED ? &state->depth_stencil : NULL;
+    state->info.pColorBlendState = state->color_formats.empty() ? NULL : &state->blend;
+    state->info.pDynamicState = &state->dynamic_state;
+    state->info.layout = layout;
+    state->info.renderPass = VK_NULL_HANDLE;
+}
 
-    //TODO: Move this code out of here and place it in its own layout struct so we can reuse layouts among many pipelines
-    VkPipelineLayoutCreateInfo pipeline_layout_info{};
-    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+int vk_pipeline_create(vk_context& context, vk_pipeline_config& config, vk_pipeline* pipeline)
+{
+    if(pipeline == NULL) return -1;
 
-    if(vkCreatePipelineLayout(context.logical_device, &pipeline_layout_info, NULL, &pipeline->layout) != VK_SUCCESS)
-    {
-        std::cerr << "Failed to create pipeline layout" << std::endl;
-        return -1;
-    }
+    pipeline->layout = config.layout != VK_NULL_HANDLE ? config.layout : context.bindless.pipeline_layout;
 
     // Renderpass setup
     // TODO: Need to fix this because framebuffers need to be able to reference this render pass
     // Likely will need to take this code out of here and figure out a way to do renderpasses elsewhere (maybe pass it in with pipeline config)
 
     VkAttachmentDescription color_attachment_desc{};
-    color_attachment_desc.format = context.swapchain.format.format;
+    color_attachment_desc.format = vk_get_color_format(context);
     color_attachment_desc.samples = VK_SAMPLE_COUNT_1_BIT;
     color_attachment_desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     color_attachment_desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     color_attachment_desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment_desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment_desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment_desc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    color_attachment_desc.finalLayout = context.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference color_attachment_ref{};
     color_attachment_ref.attachment = 0;
     color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    // Depth (and stencil for combined formats) is cleared on load and only lives for the pass
+    VkAttachmentDescription depth_attachment_desc{};
+    depth_attachment_desc.format = config.depth_format;
+    depth_attachment_desc.samples = VK_SAMPLE_COUNT_1_BIT;
+    depth_attachment_desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth_attachment_desc.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment_desc.stencilLoadOp = config.stencil_format != VK_FORMAT_UNDEFINED ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth_attachment_desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment_desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depth_attachment_desc.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depth_attachment_ref{};
+    depth_attachment_ref.attachment = 1;
+    depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    bool has_depth = config.depth_format != VK_FORMAT_UNDEFINED;
+    VkAttachmentDescription attachment_descs[] = { color_attachment_desc, depth_attachment_desc };
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &color_attachment_ref;
+    subpass.pDepthStencilAttachment = has_depth ? &depth_attachment_ref : NULL;
 
     VkSubpassDependency dependency{};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
@@ -334,11 +671,18 @@ int vk_pipeline_create(vk_context& context, vk_pipeline_config& config, vk_pipel
     dependency.srcAccessMask = 0;
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    if(has_depth)
+    {
+        dependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    }
 
     VkRenderPassCreateInfo renderpass_info{};
     renderpass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderpass_info.attachmentCount = 1;
-    renderpass_info.pAttachments = &color_attachment_desc;
+    renderpass_info.attachmentCount = has_depth ? 2 : 1;
+    renderpass_info.pAttachments = attachment_descs;
     renderpass_info.subpassCount = 1;
     renderpass_info.pSubpasses = &subpass;
     renderpass_info.dependencyCount = 1;
@@ -350,23 +694,18 @@ int vk_pipeline_create(vk_context& context, vk_pipeline_config& config, vk_pipel
         return -1;
     }
 
-    VkGraphicsPipelineCreateInfo pipeline_info{};
-    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipeline_info.stageCount = 2;
-    pipeline_info.pStages = shader_stages;
-    pipeline_info.pVertexInputState = &vertex_input_info;
-    pipeline_info.pInputAssemblyState = &input_assembly_info;
-    pipeline_info.pViewportState = &viewport_info;
-    pipeline_info.pRasterizationState = &rasterizer_info;
-    pipeline_info.pMultisampleState = &multisample_info;
-    pipeline_info.pDepthStencilState = NULL;
-    pipeline_info.pColorBlendState = &blend_info;
-    pipeline_info.pDynamicState = &dynamic_state_info;
-    pipeline_info.layout = pipeline->layout;
-    pipeline_info.renderPass = pipeline->renderpass;
-    pipeline_info.subpass = 0;
+    // The render pass has the one color attachment and the config's depth
+    vk_pipeline_config renderpass_config = config;
+    renderpass_config.color_formats.assign(1, color_attachment_desc.format);
+    renderpass_config.depth_only = 0;
 
-    if(vkCreateGraphicsPipelines(context.logical_device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &pipeline->pipeline) != VK_SUCCESS)
+    vk_pipeline_build_state state;
+    vk_pipeline_build_state_init(context, renderpass_config, pipeline->layout, &state);
+    state.info.pNext = NULL;
+    state.info.renderPass = pipeline->renderpass;
+    state.info.subpass = 0;
+
+    if(vkCreateGraphicsPipelines(context.logical_device, context.pipeline_cache, 1, &state.info, NULL, &pipeline->pipeline) != VK_SUCCESS)
     {
         std::cerr << "Failed to create graphics pipeline" << std::endl;
         return -1;
@@ -378,7 +717,6 @@ int vk_pipeline_create(vk_context& context, vk_pipeline_config& config, vk_pipel
 int vk_pipeline_destroy(vk_context& context, vk_pipeline& pipeline)
 {
     vkDestroyRenderPass(context.logical_device, pipeline.renderpass, NULL);
-    vkDestroyPipelineLayout(context.logical_device, pipeline.layout, NULL);
     vkDestroyPipeline(context.logical_device, pipeline.pipeline, NULL);
     
     return 0;
@@ -388,121 +726,60 @@ int vk_dynamic_pipeline_create(vk_context& context, vk_pipeline_config& config,
 {
     if(pipeline == NULL) return -1;
 
-    VkPipelineShaderStageCreateInfo vertex_info{};
-    vertex_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertex_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertex_info.module = config.shader.vertex;
-    vertex_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragment_info{};
-    fragment_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragment_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragment_info.module = config.shader.fragment;
-    fragment_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shader_stages[] = { vertex_info, fragment_info };
-
-
-    // TODO: Come here when implementing vertex buffers
-    VkPipelineVertexInputStateCreateInfo vertex_input_info{};
-    vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_info.vertexBindingDescriptionCount = 0;
-    vertex_input_info.pVertexBindingDescriptions = NULL;
-    vertex_input_info.vertexAttributeDescriptionCount = 0;
-    vertex_input_info.pVertexAttributeDescriptions = NULL;
-
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_info{};
-    input_assembly_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    input_assembly_info.primitiveRestartEnable = VK_FALSE;
-
-    std::vector<VkDynamicState> dynamic_states = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-
-    VkPipelineDynamicStateCreateInfo dynamic_state_info{};
-    dynamic_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamic_state_info.dynamicStateCount = dynamic_states.size();
-    dynamic_state_info.pDynamicStates = dynamic_states.data();
-
-    VkPipelineViewportStateCreateInfo viewport_info{};
-    viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewport_info.viewportCount = 1;
-    viewport_info.scissorCount = 1;
-    //viewport_info.pViewports = &viewports;
-    //viewport_info.pScissors = &scissors;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer_info{};
-    rasterizer_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer_info.depthClampEnable = VK_FALSE;
-    rasterizer_info.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer_info.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer_info.lineWidth = 1.0f;
-    rasterizer_info.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer_info.depthBiasEnable = VK_FALSE;
-    
-    VkPipelineMultisampleStateCreateInfo multisample_info{};
-    multisample_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisample_info.sampleShadingEnable = VK_FALSE;
-    multisample_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    pipeline->layout = config.layout != VK_NULL_HANDLE ? config.layout : context.bindless.pipeline_layout;
 
-    VkPipelineColorBlendAttachmentState blend_attachment{};
-    blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    blend_attachment.blendEnable = VK_FALSE;
+    vk_pipeline_build_state state;
+    vk_pipeline_build_state_init(context, config, pipeline->layout, &state);
+
+    if(vkCreateGraphicsPipelines(context.logical_device, context.pipeline_cache, 1, &state.info, NULL, &pipeline->pipeline) != VK_SUCCESS)
+    {
+        std::cerr << "Failed to create graphics pipeline" << std::endl;
+        return -1;
+    }
 
-    VkPipelineColorBlendStateCreateInfo blend_info{};
-    blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    blend_info.logicOpEnable = VK_FALSE;
-    blend_info.attachmentCount = 1;
-    blend_info.pAttachments = &blend_attachment;
+    return 0;
+}
 
+int vk_dynamic_pipeline_destroy(vk_context& context, vk_dynamic_pipeline& pipeline)
+{
+    vkDestroyPipeline(context.logical_device, pipeline.pipeline, NULL);
+    return 0;
+}
 
-    //TODO: Move this code out of here and place it in its own layout struct so we can reuse layouts among many pipelines
-    VkPipelineLayoutCreateInfo pipeline_layout_info{};
-    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+int vk_compute_pipeline_create(vk_context& context, const std::string& path, VkPipelineLayout layout, vk_dynamic_pipeline* pipeline)
+{
+    if(pipeline == NULL) return -1;
 
-    if(vkCreatePipelineLayout(context.logical_device, &pipeline_layout_info, NULL, &pipeline->layout) != VK_SUCCESS)
+    pipeline->layout = layout != VK_NULL_HANDLE ? layout : context.bindless.pipeline_layout;
+
+    VkShaderModule module;
+    if(vk_create_shader_module(context, path, &module) < 0)
     {
-        std::cerr << "Failed to create pipeline layout" << std::endl;
         return -1;
     }
 
-    VkPipelineRenderingCreateInfoKHR pipeline_rendering_info{};
-    pipeline_rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
-    pipeline_rendering_info.colorAttachmentCount = 1;
-    pipeline_rendering_info.pColorAttachmentFormats = &context.swapchain.format.format;
-
-    VkGraphicsPipelineCreateInfo pipeline_info{};
-    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipeline_info.stageCount = 2;
-    pipeline_info.pStages = shader_stages;
-    pipeline_info.pVertexInputState = &vertex_input_info;
-    pipeline_info.pInputAssemblyState = &input_assembly_info;
-    pipeline_info.pViewportState = &viewport_info;
-    pipeline_info.pRasterizationState = &rasterizer_info;
-    pipeline_info.pMultisampleState = &multisample_info;
-    pipeline_info.pDepthStencilState = NULL;
-    pipeline_info.pColorBlendState = &blend_info;
-    pipeline_info.pDynamicState = &dynamic_state_info;
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = module;
+    pipeline_info.stage.pName = "main";
     pipeline_info.layout = pipeline->layout;
-    pipeline_info.renderPass = VK_NULL_HANDLE;
-    pipeline_info.pNext = &pipeline_rendering_info;
 
-    if(vkCreateGraphicsPipelines(context.logical_device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &pipeline->pipeline) != VK_SUCCESS)
+    VkResult result = vkCreateComputePipelines(context.logical_device, context.pipeline_cache, 1, &pipeline_info, NULL, &pipeline->pipeline);
+
+    // The module is only needed while the pipeline is being created
+    vkDestroyShaderModule(context.logical_device, module, NULL);
+
+    if(result != VK_SUCCESS)
     {
-        std::cerr << "Failed to create graphics pipeline" << std::endl;
+        std::cerr << "Failed to create compute pipeline" << std::endl;
         return -1;
     }
 
     return 0;
 }
 
-int vk_dynamic_pipeline_destroy(vk_context& context, vk_dynamic_pipeline& pipeline)
-{
-    vkDestroyPipelineLayout(context.logical_device, pipeline.layout, NULL);
-    vkDestroyPipeline(context.logical_device, pipeline.pipeline, NULL);
-    return 0;
-}
-
 int vk_command_pool_create(vk_context& context, vk_command_pool* pool, uint32_t queue_index)
 {
     VkCommandPoolCreateInfo pool_info{};
@@ -563,7 +840,7 @@ static std::vector<char> load_file_bytes(const std::string& path)
     return buffer;
 }
 
-static int vk_create_swapchain(vk_context* context, GLFWwindow* window)
+static int vk_create_swapchain(vk_context* context, VkSwapchainKHR old_swapchain)
 {
     VkSurfaceCapabilitiesKHR surface_capabilities;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(context->physical_device, context->surface, &surface_capabilities);
@@ -588,13 +865,18 @@ static int vk_create_swapchain(vk_context* context, GLFWwindow* window)
         }
     }
 
+    // FIFO is the only mode every surface supports, throughput takes MAILBOX (no tearing) or IMMEDIATE over it
     context->swapchain.present_mode = VK_PRESENT_MODE_FIFO_KHR;
-    for(const VkPresentModeKHR& mode : present_modes)
+    if(context->present_policy == VK_PRESENT_POLICY_THROUGHPUT)
     {
-        if(mode == VK_PRESENT_MODE_MAILBOX_KHR)
+        const VkPresentModeKHR preferred_modes[] = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+        for(VkPresentModeKHR mode : preferred_modes)
         {
-            context->swapchain.present_mode = mode;
-            break;
+            if(std::find(present_modes.begin(), present_modes.end(), mode) != present_modes.end())
+            {
+                context->swapchain.present_mode = mode;
+                break;
+            }
         }
     }
 
@@ -605,7 +887,7 @@ static int vk_create_swapchain(vk_context* context, GLFWwindow* window)
     else
     {
         int width, height;
-        glfwGetFramebufferSize(window, &width, &height);
+        glfwGetFramebufferSize(context->window, &width, &height);
 
         VkExtent2D actual_extent =
         {
@@ -619,13 +901,30 @@ static int vk_create_swapchain(vk_context* context, GLFWwindow* window)
         context->swapchain.extent = actual_extent;
     }
 
+    // Throughput keeps a spare image on top of the displayed and the rendered one so the GPU never waits for a free image,
+    // low latency takes as few as the surface allows so finished frames can't queue up in front of the display
     uint32_t image_count = surface_capabilities.minImageCount + 1;
+    if(context->present_policy == VK_PRESENT_POLICY_THROUGHPUT)
+    {
+        image_count = surface_capabilities.minImageCount + 2;
+    }
+    else if(context->present_policy == VK_PRESENT_POLICY_LOW_LATENCY)
+    {
+        image_count = surface_capabilities.minImageCount;
+    }
+
+    if(context->swapchain_image_count > 0)
+    {
+        image_count = std::max(context->swapchain_image_count, surface_capabilities.minImageCount);
+    }
+
     if(surface_capabilities.maxImageCount > 0 && image_count > surface_capabilities.maxImageCount)
     {
         image_count = surface_capabilities.maxImageCount;
     }
 
     context->swapchain.image_count = image_count;
+    context->swapchain.present_id = 0;
 
     VkSwapchainCreateInfoKHR swapchain_info{};
     swapchain_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -654,7 +953,7 @@ static int vk_create_swapchain(vk_context* context, GLFWwindow* window)
     swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapchain_info.presentMode = context->swapchain.present_mode;
     swapchain_info.clipped = VK_TRUE;
-    swapchain_info.oldSwapchain = VK_NULL_HANDLE;
+    swapchain_info.oldSwapchain = old_swapchain;
 
     if(vkCreateSwapchainKHR(context->logical_device, &swapchain_info, NULL, &context->swapchain.swapchain) != VK_SUCCESS)
     {   
@@ -695,9 +994,419 @@ static int vk_create_swapchain(vk_context* context, GLFWwindow* window)
 }
 
 
+int vk_swapchain_recreate(vk_context* context, uint64_t last_submitted_serial)
+{
+    VK_CPU_ZONE("vk_swapchain_recreate");
+
+    if(context == NULL || context->headless) return -1;
+
+    // A minimized window has a zero sized framebuffer and no valid swapchain extent, try again once it's restored
+    int width, height;
+    glfwGetFramebufferSize(context->window, &width, &height);
+    if(width == 0 || height == 0)
+    {
+        return 1;
+    }
+
+    vk_swapchain old_swapchain = context->swapchain;
+
+    // Passing the old swapchain lets the driver hand its resources over and keeps presenting the old images in the meantime
+    if(vk_create_swapchain(context, old_swapchain.swapchain) < 0)
+    {
+        std::cerr << "Failed to recreate swapchain" << std::endl;
+        context->swapchain = old_swapchain;
+        return -1;
+    }
+
+    // Frames still in flight may reference the old image views, they get destroyed in vk_swapchain_collect once
+    // the last frame submitted against them has completed instead of stalling the whole device here
+    vk_retired_swapchain retired{};
+    retired.swapchain = old_swapchain.swapchain;
+    retired.image_views = old_swapchain.image_views;
+    retired.retire_serial = last_submitted_serial;
+    context->retired_swapchains.push_back(retired);
+
+    return 0;
+}
+
+VkResult vk_swapchain_present(vk_context* context, VkQueue queue, VkSemaphore wait_semaphore, uint32_t image_index)
+{
+    VK_CPU_ZONE("vk_swapchain_present");
+
+    VkPresentInfoKHR present_info{};
+    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    present_info.waitSemaphoreCount = 1;
+    present_info.pWaitSemaphores = &wait_semaphore;
+    present_info.swapchainCount = 1;
+    present_info.pSwapchains = &context->swapchain.swapchain;
+    present_info.pImageIndices = &image_index;
+    present_info.pResults = NULL;
+
+    uint64_t present_id = context->swapchain.present_id + 1;
+
+    VkPresentIdKHR present_id_info{};
+    present_id_info.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    present_id_info.swapchainCount = 1;
+    present_id_info.pPresentIds = &present_id;
+
+    if(context->present_wait)
+    {
+        present_info.pNext = &present_id_info;
+    }
+
+    VkResult result = vkQueuePresentKHR(queue, &present_info);
+
+    // Suboptimal presents still reach the display, failed / out of date ones never complete and must not be waited on
+    if(result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+    {
+        context->swapchain.present_id = present_id;
+    }
+
+    return result;
+}
+
+void vk_swapchain_wait_present(vk_context* context, uint64_t timeout_ns)
+{
+    if(!context->present_wait || context->swapchain.present_id == 0) return;
+
+    VK_CPU_ZONE("vk_swapchain_wait_present");
+
+    // Timeouts (e.g. an occluded window that never presents) and out of date swapchains just end the wait early,
+    // acquire / present report the swapchain state
+    context->wait_for_present(context->logical_device, context->swapchain.swapchain, context->swapchain.present_id, timeout_ns);
+}
+
+int vk_swapchain_poll_present(vk_context* context, uint64_t present_id)
+{
+    if(!context->present_wait || present_id == 0 || present_id > context->swapchain.present_id) return -1;
+
+    VkResult result = context->wait_for_present(context->logical_device, context->swapchain.swapchain, present_id, 0);
+    if(result == VK_SUCCESS) return 1;
+    if(result == VK_TIMEOUT) return 0;
+    return -1;
+}
+
+void vk_swapchain_collect(vk_context* context, uint64_t completed_serial)
+{
+    size_t kept = 0;
+    for(size_t i = 0; i < context->retired_swapchains.size(); i++)
+    {
+        vk_retired_swapchain& retired = context->retired_swapchains[i];
+        if(retired.retire_serial <= completed_serial)
+        {
+            vk_destroy_swapchain_views(context, retired.image_views);
+            vkDestroySwapchainKHR(context->logical_device, retired.swapchain, NULL);
+        }
+        else
+        {
+            context->retired_swapchains[kept++] = retired;
+        }
+    }
+
+    context->retired_swapchains.resize(kept);
+}
+
+static void vk_destroy_swapchain_views(vk_context* context, std::vector<VkImageView>& image_views)
+{
+    for(VkImageView& view : image_views)
+    {
+        vkDestroyImageView(context->logical_device, view, NULL);
+    }
+    image_views.clear();
+}
+
+static int vk_create_offscreen_target(vk_context* context, uint32_t width, uint32_t height, uint32_t image_count)
+{
+    // RGBA8 UNORM is required to support color attachment + blit on every implementation, including lavapipe
+    context->offscreen.format = VK_FORMAT_R8G8B8A8_UNORM;
+    context->offscreen.extent = { width, height };
+    context->offscreen.image_count = image_count;
+    context->offscreen.images.resize(image_count);
+    context->offscreen.image_views.resize(image_count);
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = context->offscreen.format;
+    image_info.extent = { width, height, 1 };
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = context->offscreen.format;
+    view_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.baseMipLevel = 0;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount = 1;
+
+    for(int i = 0; i < image_count; i++)
+    {
+        if(vk_image_create(context->allocator, image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &context->offscreen.images[i]) < 0)
+        {
+            return -1;
+        }
+
+        view_info.image = context->offscreen.images[i].image;
+        if(vkCreateImageView(context->logical_device, &view_info, NULL, &context->offscreen.image_views[i]) != VK_SUCCESS)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+VkFormat vk_get_color_format(const vk_context& context)
+{
+    return context.headless ? context.offscreen.format : context.swapchain.format.format;
+}
+
+VkExtent2D vk_get_render_extent(const vk_context& context)
+{
+    return context.headless ? context.offscreen.extent : context.swapchain.extent;
+}
+
+VkFormat vk_find_depth_format(const vk_context& context, uint8_t stencil)
+{
+    const VkFormat depth_formats[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM };
+    const VkFormat stencil_formats[] = { VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D16_UNORM_S8_UINT };
+    const VkFormat* candidates = stencil ? stencil_formats : depth_formats;
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(context.physical_device, candidates[i], &properties);
+        if(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+        {
+            return candidates[i];
+        }
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+VkImageAspectFlags vk_format_aspect(VkFormat format)
+{
+    switch(format)
+    {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        case VK_FORMAT_S8_UINT:
+            return VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+VkSampleCountFlagBits vk_max_sample_count(const vk_context& context, VkSampleCountFlagBits requested)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.physical_device, &properties);
+
+    VkSampleCountFlags supported = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+    uint32_t samples = requested;
+    while(samples > 1 && !(supported & samples))
+    {
+        samples >>= 1;
+    }
+
+    return (VkSampleCountFlagBits)samples;
+}
+
+// Prefixed to the driver's cache blob on disk. The driver header only carries vendor / device / cache UUID,
+// so the driver version and a checksum are tracked here to reject caches from other drivers or torn writes.
+struct vk_pipeline_cache_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint8_t uuid[VK_UUID_SIZE];
+    uint64_t data_size;
+    uint64_t checksum;
+};
+
+static const uint32_t PIPELINE_CACHE_MAGIC = 0x4B504356;   // "VCPK"
+static const uint32_t PIPELINE_CACHE_VERSION = 1;
+
+static uint64_t fnv1a_64(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static const std::string& vk_pipeline_cache_path(vk_context* context)
+{
+    if(context->pipeline_cache_path.empty())
+    {
+        context->pipeline_cache_path = VK_DEFAULT_PIPELINE_CACHE_PATH;
+    }
+    return context->pipeline_cache_path;
+}
+
+static int vk_load_pipeline_cache(vk_context* context)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->physical_device, &properties);
+
+    // No cache on disk yet (first launch) just means we start with an empty one
+    std::vector<char> file_bytes;
+    if(std::ifstream(vk_pipeline_cache_path(context), std::ios::binary).good())
+    {
+        file_bytes = load_file_bytes(vk_pipeline_cache_path(context));
+    }
+
+    const char* initial_data = NULL;
+    size_t initial_size = 0;
+
+    if(file_bytes.size() >= sizeof(vk_pipeline_cache_file_header))
+    {
+        vk_pipeline_cache_file_header header;
+        memcpy(&header, file_bytes.data(), sizeof(header));
+
+        const char* data = file_bytes.data() + sizeof(header);
+        size_t data_size = file_bytes.size() - sizeof(header);
+
+        bool valid = header.magic == PIPELINE_CACHE_MAGIC &&
+                     header.version == PIPELINE_CACHE_VERSION &&
+                     header.vendor_id == properties.vendorID &&
+                     header.device_id == properties.deviceID &&
+                     header.driver_version == properties.driverVersion &&
+                     memcmp(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+                     header.data_size == data_size &&
+                     header.checksum == fnv1a_64(data, data_size);
+
+        // Double check against the driver's own header so we never hand it a blob it would have to reject
+        if(valid && data_size >= sizeof(VkPipelineCacheHeaderVersionOne))
+        {
+            VkPipelineCacheHeaderVersionOne driver_header;
+            memcpy(&driver_header, data, sizeof(driver_header));
+            valid = driver_header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                    driver_header.vendorID == properties.vendorID &&
+                    driver_header.deviceID == properties.deviceID &&
+                    memcmp(driver_header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if(valid)
+        {
+            initial_data = data;
+            initial_size = data_size;
+        }
+        else
+        {
+            std::cout << "Discarding stale pipeline cache" << std::endl;
+        }
+    }
+
+    VkPipelineCacheCreateInfo cache_info{};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.initialDataSize = initial_size;
+    cache_info.pInitialData = initial_data;
+
+    if(vkCreatePipelineCache(context->logical_device, &cache_info, NULL, &context->pipeline_cache) != VK_SUCCESS)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int vk_save_pipeline_cache(vk_context* context)
+{
+    if(context->pipeline_cache == VK_NULL_HANDLE) return -1;
+
+    size_t data_size = 0;
+    if(vkGetPipelineCacheData(context->logical_device, context->pipeline_cache, &data_size, NULL) != VK_SUCCESS || data_size == 0)
+    {
+        return -1;
+    }
+
+    std::vector<char> data(data_size);
+    if(vkGetPipelineCacheData(context->logical_device, context->pipeline_cache, &data_size, data.data()) != VK_SUCCESS)
+    {
+        return -1;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->physical_device, &properties);
+
+    vk_pipeline_cache_file_header header{};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.vendor_id = properties.vendorID;
+    header.device_id = properties.deviceID;
+    header.driver_version = properties.driverVersion;
+    memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.data_size = data_size;
+    header.checksum = fnv1a_64(data.data(), data_size);
+
+    // Write to a temporary file and rename it over the old cache so a crash mid-write can't leave a torn file behind
+    const std::string& path = vk_pipeline_cache_path(context);
+    std::string temp_path = path + ".tmp";
+
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+        std::cerr << "Failed to write pipeline cache" << std::endl;
+        return -1;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write(data.data(), data_size);
+    file.close();
+
+    if(file.fail())
+    {
+        std::remove(temp_path.c_str());
+        std::cerr << "Failed to write pipeline cache" << std::endl;
+        return -1;
+    }
+
+#ifdef _WIN32
+    // rename() won't replace an existing file on windows
+    std::remove(path.c_str());
+#endif
+    if(std::rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temp_path.c_str());
+        std::cerr << "Failed to write pipeline cache" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
 queue_families vk_get_device_queues(const VkPhysicalDevice& physical_device, vk_context& context)
 {
-    queue_families queues;
+    queue_families queues{};
     uint32_t queue_family_count = 0;
 
 
@@ -705,6 +1414,24 @@ queue_families vk_get_device_queues(const VkPhysicalDevice& physical_device, vk_
     std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
     vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
 
+    for(int i = 0; i < queue_families.size(); i++)
+    {
+        VkQueueFlags flags = queue_families[i].queueFlags;
+
+        // Dedicated families are the ones without graphics, these run alongside the graphics queue instead of behind it
+        if(!(flags & VK_QUEUE_GRAPHICS_BIT) && (flags & VK_QUEUE_COMPUTE_BIT) && !queues.has_compute)
+        {
+            queues.compute = i;
+            queues.has_compute = 1;
+        }
+
+        if(!(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && (flags & VK_QUEUE_TRANSFER_BIT) && !queues.has_transfer)
+        {
+            queues.transfer = i;
+            queues.has_transfer = 1;
+        }
+    }
+
     for(int i = 0; i < queue_families.size(); i++)
     {
         if(queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
@@ -713,6 +1440,16 @@ queue_families vk_get_device_queues(const VkPhysicalDevice& physical_device, vk_
             queues.has_graphics = 1;
         }
 
+        // Headless contexts have no surface so there is nothing to present to
+        if(context.surface == VK_NULL_HANDLE)
+        {
+            if(queues.has_graphics)
+            {
+                break;
+            }
+            continue;
+        }
+
         VkBool32 present_support = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, context.surface, &present_support);
         if(present_support)
@@ -727,26 +1464,61 @@ queue_families vk_get_device_queues(const VkPhysicalDevice& physical_device, vk_
         }
     }
 
+    if(!queues.has_transfer) queues.transfer = queues.graphics;
+    if(!queues.has_compute) queues.compute = queues.graphics;
+
     return queues;
 }
 
 int vk_terminate(vk_context* context)
 {
 
-    for(VkImageView& view : context->swapchain.image_views)
+    if(context->headless)
     {
-        vkDestroyImageView(context->logical_device, view, NULL);
+        for(int i = 0; i < context->offscreen.images.size(); i++)
+        {
+            vkDestroyImageView(context->logical_device, context->offscreen.image_views[i], NULL);
+            vk_image_destroy(context->allocator, context->offscreen.images[i]);
+        }
+    }
+    else
+    {
+        vk_swapchain_collect(context, UINT64_MAX);
+
+        vk_destroy_swapchain_views(context, context->swapchain.image_views);
+        vkDestroySwapchainKHR(context->logical_device, context->swapchain.swapchain, NULL);
     }
 
-    vkDestroySwapchainKHR(context->logical_device, context->swapchain.swapchain, NULL);
+    vk_save_pipeline_cache(context);
+    vkDestroyPipelineCache(context->logical_device, context->pipeline_cache, NULL);
+
+    vk_bindless_destroy(context->logical_device, context->bindless);
+    vk_allocator_destroy(context->allocator);
+    vk_shader_pack_close(context->shader_pack);
+
     vkDestroyDevice(context->logical_device, NULL);
-    vkDestroySurfaceKHR(context->instance, context->surface, NULL);
-    DestroyDebugUtilsMessengerEXT(context->instance, context->debug_messenger, NULL);
+    if(context->surface != VK_NULL_HANDLE)
+    {
+        vkDestroySurfaceKHR(context->instance, context->surface, NULL);
+    }
+#ifdef VK_DEBUG_LAYERS
+    if(context->debug_messenger != VK_NULL_HANDLE)
+    {
+        DestroyDebugUtilsMessengerEXT(context->instance, context->debug_messenger, NULL);
+    }
+#endif
     vkDestroyInstance(context->instance, NULL);
 
+#ifdef VK_DEBUG_LAYERS
+    vk_debug_log_flush(context->debug_log);
+    vk_debug_log_destroy(context->debug_log);
+    context->debug_log = NULL;
+#endif
+
     return 0;
 }
 
+#ifdef VK_DEBUG_LAYERS
 static VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
     auto func = (PFN_vkCreateDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
     if (func != nullptr) {
@@ -762,15 +1534,4 @@ static void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMesse
         func(instance, debugMessenger, pAllocator);
     }
 }
-
-static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(
-    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-    VkDebugUtilsMessageTypeFlagsEXT messageType,
-    const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-    void* pUserData) 
-{
-
-    std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-
-    return VK_FALSE;
-}
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -3,13 +3,35 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <string>
+#include "vk_allocator.h"
+#include "vk_mesh.h"
+#include "vk_shader_pack.h"
+#include "vk_bindless.h"
+#include "vk_debug.h"
 
+// Where the pipeline cache is loaded from / saved to if the context doesn't specify a path
+#define VK_DEFAULT_PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
+// How vk_create_swapchain picks the present mode and image count, set vk_context::present_policy before vk_init
+// Changing it later takes effect on the next vk_swapchain_recreate
+enum vk_present_policy
+{
+    VK_PRESENT_POLICY_THROUGHPUT = 0,   // MAILBOX, then IMMEDIATE (tears), then FIFO with a spare image so rendering never waits on the display
+    VK_PRESENT_POLICY_VSYNC = 1,        // FIFO, frames queue up behind the display
+    VK_PRESENT_POLICY_LOW_LATENCY = 2   // FIFO with as few images as the surface allows, paced with vk_swapchain_wait_present
+};
+
+// transfer and compute fall back to the graphics family when the device has no dedicated family for them
 struct queue_families
 {
     uint32_t graphics;
     uint32_t present;
+    uint32_t transfer;
+    uint32_t compute;
     uint8_t has_graphics;
     uint8_t has_present;
+    uint8_t has_transfer;   // transfer is a transfer only (DMA) family
+    uint8_t has_compute;    // compute is a compute family without graphics (async compute)
 };
 
 struct vk_swapchain
@@ -21,6 +43,25 @@ struct vk_swapchain
     VkPresentModeKHR present_mode;
     VkExtent2D extent;
     uint32_t image_count;
+    uint64_t present_id;    // Id of the last vk_swapchain_present, ids restart at 0 with every new swapchain
+};
+
+// Swapchain replaced by vk_swapchain_recreate that may still be in use by frames in flight
+struct vk_retired_swapchain
+{
+    VkSwapchainKHR swapchain;
+    std::vector<VkImageView> image_views;
+    uint64_t retire_serial;     // Safe to destroy once the frame with this serial has completed
+};
+
+// Device owned color targets used in place of the swapchain when running without a window
+struct vk_offscreen_target
+{
+    std::vector<vk_image> images;
+    std::vector<VkImageView> image_views;
+    VkFormat format;
+    VkExtent2D extent;
+    uint32_t image_count;
 };
 
 struct vk_context
@@ -30,7 +71,23 @@ struct vk_context
     VkDevice logical_device;
     VkSurfaceKHR surface;
     VkDebugUtilsMessengerEXT debug_messenger;
+    vk_debug_config debug;          // Set before vk_init / vk_init_headless, only used with VK_DEBUG_LAYERS
+    vk_debug_log* debug_log;        // Drain with vk_debug_log_flush, NULL when validation is off
+    GLFWwindow* window;
     vk_swapchain swapchain;
+    std::vector<vk_retired_swapchain> retired_swapchains;
+    vk_offscreen_target offscreen;  // Only valid when headless is set
+    uint8_t headless;
+    VkPipelineCache pipeline_cache;
+    std::string pipeline_cache_path;    // Set before vk_init to override VK_DEFAULT_PIPELINE_CACHE_PATH
+    vk_present_policy present_policy;   // Set before vk_init
+    uint32_t swapchain_image_count;     // Set before vk_init to override the policy's image count, 0 keeps it
+    uint8_t pipeline_statistics;        // pipelineStatisticsQuery / inheritedQueries are enabled
+    uint8_t present_wait;               // VK_KHR_present_id / VK_KHR_present_wait are enabled
+    PFN_vkWaitForPresentKHR wait_for_present;
+    vk_allocator allocator;
+    vk_shader_pack shader_pack;     // Opened with vk_shader_pack_open, vk_shader_create looks paths up here before the filesystem
+    vk_bindless_heap bindless;      // Its pipeline_layout is the layout every pipeline uses unless the config provides one
 };
 
 struct vk_shader
@@ -39,18 +96,68 @@ struct vk_shader
     VkShaderModule fragment;
 };
 
+struct vk_blend_state
+{
+    VkBool32 enable = VK_FALSE;
+    VkBlendFactor src_color = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dst_color = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp color_op = VK_BLEND_OP_ADD;
+    VkBlendFactor src_alpha = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dst_alpha = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp alpha_op = VK_BLEND_OP_ADD;
+    VkColorComponentFlags write_mask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+};
+
+// Everything that goes into a graphics pipeline, a value initialized config is an opaque triangle list pipeline
+// rendering into the context's color format
 struct vk_pipeline_config
 {
     vk_shader shader;
     VkRenderPass renderpass;
-    // vertex attribute stuff
-    // uniform layout stuff (will likely make this it's own struct that you have to free yourself so it can be reused among many pipelines)
+    vk_vertex_layout vertex_layout;     // Leave empty for shaders that generate their own vertices
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygon_mode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cull_mode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace front_face = VK_FRONT_FACE_CLOCKWISE;
+    VkBool32 depth_test = VK_FALSE;
+    VkBool32 depth_write = VK_FALSE;
+    VkCompareOp depth_compare = VK_COMPARE_OP_LESS_OR_EQUAL;
+    VkBool32 stencil_test = VK_FALSE;
+    VkStencilOpState stencil_front{};
+    VkStencilOpState stencil_back{};
+    vk_blend_state blend;                   // Applied to every color attachment
+    std::vector<VkFormat> color_formats;    // Empty means one attachment in the context's color format
+    uint8_t depth_only = 0;                 // No color attachments at all (depth prepass / shadow pipelines), shader.fragment may be null
+    VkFormat depth_format = VK_FORMAT_UNDEFINED;
+    VkFormat stencil_format = VK_FORMAT_UNDEFINED;  // Same as depth_format for combined depth / stencil formats
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkPipelineLayout layout = VK_NULL_HANDLE;   // Null means the bindless heap's shared layout
+};
+
+// Fixed function state of a graphics pipeline filled in from a vk_pipeline_config
+// Holds pointers into itself so it must stay where it was initialized until vkCreateGraphicsPipelines returns
+struct vk_pipeline_build_state
+{
+    VkPipelineShaderStageCreateInfo stages[2];
+    VkPipelineVertexInputStateCreateInfo vertex_input;
+    VkPipelineInputAssemblyStateCreateInfo input_assembly;
+    VkDynamicState dynamic_states[2];
+    VkPipelineDynamicStateCreateInfo dynamic_state;
+    VkPipelineViewportStateCreateInfo viewport;
+    VkPipelineRasterizationStateCreateInfo rasterizer;
+    VkPipelineMultisampleStateCreateInfo multisample;
+    VkPipelineDepthStencilStateCreateInfo depth_stencil;
+    std::vector<VkPipelineColorBlendAttachmentState> blend_attachments;
+    VkPipelineColorBlendStateCreateInfo blend;
+    std::vector<VkFormat> color_formats;
+    VkPipelineRenderingCreateInfoKHR rendering;
+    VkGraphicsPipelineCreateInfo info;
 };
 
 struct vk_dynamic_pipeline
 {
     VkPipeline pipeline;
-    VkPipelineLayout layout;
+    VkPipelineLayout layout;    // Not owned by the pipeline
 };
 
 struct vk_dynamic_framebuffer
@@ -63,7 +170,7 @@ struct vk_dynamic_framebuffer
 struct vk_pipeline
 {
     VkPipeline pipeline;
-    VkPipelineLayout layout;    // Storing this here for now but will likely move this out so layouts can be reused among many pipelines
+    VkPipelineLayout layout;    // Not owned by the pipeline
     VkRenderPass renderpass;
 };
 
@@ -79,9 +186,17 @@ struct vk_command_pool
 // -1 - failure
 int vk_init(vk_context* context, GLFWwindow* window);
 
+// Initializes vulkan without a window / surface / swapchain and renders into image_count offscreen images instead
+// 0 - success
+// -1 - failure
+int vk_init_headless(vk_context* context, uint32_t width, uint32_t height, uint32_t image_count);
+
 // Deinitializes vulkan and frees context data;
+// Also writes the pipeline cache back to disk
 int vk_terminate(vk_context* context);
 
+// Paths are resolved through context.shader_pack when one is open, then the embedded shaders (by file name, e.g.
+// "default.vert") and loaded from disk otherwise
 int vk_shader_create(const std::string& vert_path, const std::string& frag_path, vk_context& context, vk_shader* shader);
 void vk_shader_destroy(vk_context& context, vk_shader& shader);
 
@@ -91,6 +206,50 @@ int vk_pipeline_destroy(vk_context& context, vk_pipeline& pipeline);
 int vk_dynamic_pipeline_create(vk_context& context, vk_pipeline_config& config, vk_dynamic_pipeline* pipeline);
 int vk_dynamic_pipeline_destroy(vk_context& context, vk_dynamic_pipeline& pipeline);
 
+// Compute pipeline for the shader at path (resolved like vk_shader_create), a null layout means the bindless heap's shared layout
+// Destroy with vk_dynamic_pipeline_destroy
+int vk_compute_pipeline_create(vk_context& context, const std::string& path, VkPipelineLayout layout, vk_dynamic_pipeline* pipeline);
+
+// Fills state->info for a dynamic rendering pipeline using layout, set info.renderPass (and clear info.pNext) for render pass pipelines
+void vk_pipeline_build_state_init(const vk_context& context, const vk_pipeline_config& config, VkPipelineLayout layout, vk_pipeline_build_state* state);
+
+// Recreates the swapchain (e.g. after a resize or VK_ERROR_OUT_OF_DATE_KHR) without waiting for the device to idle
+// last_submitted_serial is the serial of the most recent frame submitted against the current swapchain
+// 0 - success
+// 1 - window is minimized, nothing was recreated
+// -1 - failure
+int vk_swapchain_recreate(vk_context* context, uint64_t last_submitted_serial);
+
+// Presents image_index once wait_semaphore is signaled, tagged with the next present id when present wait is enabled
+// Returns vkQueuePresentKHR's result
+VkResult vk_swapchain_present(vk_context* context, VkQueue queue, VkSemaphore wait_semaphore, uint32_t image_index);
+
+// Blocks until the last vk_swapchain_present is on screen or timeout_ns passed
+// Returns right away without present wait or before the swapchain's first present
+void vk_swapchain_wait_present(vk_context* context, uint64_t timeout_ns);
+
+// 1 - present_id of the current swapchain is on screen
+// 0 - not yet
+// -1 - it never will be (no present wait, swapchain out of date / lost)
+int vk_swapchain_poll_present(vk_context* context, uint64_t present_id);
+
+// Destroys retired swapchains whose last frame (serial <= completed_serial) has finished executing
+void vk_swapchain_collect(vk_context* context, uint64_t completed_serial);
+
+// Format / extent of whatever the context renders into (swapchain images or offscreen images when headless)
+VkFormat vk_get_color_format(const vk_context& context);
+VkExtent2D vk_get_render_extent(const vk_context& context);
+
+// First depth format the device can use as an optimal tiling attachment, with a stencil aspect when stencil is set
+// VK_FORMAT_UNDEFINED if there is none
+VkFormat vk_find_depth_format(const vk_context& context, uint8_t stencil);
+
+// Aspects of format's images (color, depth and / or stencil)
+VkImageAspectFlags vk_format_aspect(VkFormat format);
+
+// Highest sample count up to requested that color and depth attachments both support
+VkSampleCountFlagBits vk_max_sample_count(const vk_context& context, VkSampleCountFlagBits requested);
+
 queue_families vk_get_device_queues(const VkPhysicalDevice& physical_device, vk_context& context);
 
 int vk_command_pool_create(vk_context& context, vk_command_pool* pool, uint32_t queue_index);
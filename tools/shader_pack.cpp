@@ -0,0 +1,159 @@
+// Builds a shader pack (see src/vk_shader_pack.h) out of compiled SPIR-V files
+// usage: shader_pack <output> <file.spv>[=name] ...
+// Each module is looked up by name at runtime, which defaults to the path as given on the command line.
+
+#include "vk_shader_pack.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+struct pack_input
+{
+    std::string name;
+    uint32_t blob;
+};
+
+struct pack_blob
+{
+    std::vector<char> bytes;
+    uint64_t hash;
+    uint64_t offset;
+};
+
+static int read_file(const std::string& path, std::vector<char>* bytes)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if(!file.is_open()) return -1;
+
+    bytes->resize(file.tellg());
+    file.seekg(0);
+    file.read(bytes->data(), bytes->size());
+    return file ? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: shader_pack <output> <file.spv>[=name] ..." << std::endl;
+        return 1;
+    }
+
+    std::vector<pack_input> inputs;
+    std::vector<pack_blob> blobs;
+
+    for(int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        size_t split = arg.find('=');
+        std::string path = arg.substr(0, split);
+        std::string name = vk_shader_pack_normalize(split == std::string::npos ? path : arg.substr(split + 1));
+
+        std::vector<char> bytes;
+        if(read_file(path, &bytes) < 0 || bytes.empty() || bytes.size() % 4 != 0)
+        {
+            std::cerr << "Failed to read SPIR-V from " << path << std::endl;
+            return 1;
+        }
+
+        // Identical modules are only stored once
+        uint64_t hash = vk_shader_pack_hash(bytes.data(), bytes.size());
+        uint32_t blob = 0;
+        for(; blob < blobs.size(); blob++)
+        {
+            if(blobs[blob].hash == hash && blobs[blob].bytes == bytes) break;
+        }
+        if(blob == blobs.size())
+        {
+            blobs.push_back(pack_blob{ bytes, hash, 0 });
+        }
+
+        for(const pack_input& input : inputs)
+        {
+            if(input.name == name)
+            {
+                std::cerr << "Duplicate shader name " << name << std::endl;
+                return 1;
+            }
+        }
+        inputs.push_back(pack_input{ name, blob });
+    }
+
+    std::sort(inputs.begin(), inputs.end(), [](const pack_input& a, const pack_input& b)
+    {
+        return vk_shader_pack_hash(a.name.data(), a.name.size()) < vk_shader_pack_hash(b.name.data(), b.name.size());
+    });
+
+    std::string names;
+    std::vector<vk_shader_pack_entry> entries(inputs.size());
+
+    vk_shader_pack_header header{};
+    header.magic = VK_SHADER_PACK_MAGIC;
+    header.version = VK_SHADER_PACK_VERSION;
+    header.entry_count = inputs.size();
+    header.names_offset = sizeof(vk_shader_pack_header) + entries.size() * sizeof(vk_shader_pack_entry);
+
+    for(size_t i = 0; i < inputs.size(); i++)
+    {
+        entries[i].path_hash = vk_shader_pack_hash(inputs[i].name.data(), inputs[i].name.size());
+        entries[i].name_offset = names.size();
+        entries[i].name_size = inputs[i].name.size();
+        names += inputs[i].name;
+    }
+    header.names_size = names.size();
+
+    uint64_t offset = header.names_offset + header.names_size;
+    for(pack_blob& blob : blobs)
+    {
+        offset = (offset + VK_SHADER_PACK_ALIGNMENT - 1) & ~(uint64_t)(VK_SHADER_PACK_ALIGNMENT - 1);
+        blob.offset = offset;
+        offset += blob.bytes.size();
+    }
+
+    for(size_t i = 0; i < inputs.size(); i++)
+    {
+        const pack_blob& blob = blobs[inputs[i].blob];
+        entries[i].content_hash = blob.hash;
+        entries[i].data_offset = blob.offset;
+        entries[i].data_size = blob.bytes.size();
+    }
+
+    // Write to a temporary file first so a failed build never leaves a truncated pack behind
+    std::string output = argv[1];
+    std::string temp_path = output + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)entries.data(), entries.size() * sizeof(vk_shader_pack_entry));
+        file.write(names.data(), names.size());
+
+        uint64_t written = header.names_offset + header.names_size;
+        static const char padding[VK_SHADER_PACK_ALIGNMENT] = {};
+        for(const pack_blob& blob : blobs)
+        {
+            file.write(padding, blob.offset - written);
+            file.write(blob.bytes.data(), blob.bytes.size());
+            written = blob.offset + blob.bytes.size();
+        }
+
+        if(!file)
+        {
+            std::cerr << "Failed to write " << temp_path << std::endl;
+            return 1;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(output.c_str());
+#endif
+    if(std::rename(temp_path.c_str(), output.c_str()) != 0)
+    {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+
+    std::cout << "Packed " << inputs.size() << " shaders (" << blobs.size() << " unique) into " << output << std::endl;
+    return 0;
+}